@@ -30,6 +30,10 @@
 #include <glib/gi18n.h>
 #include <locale.h>
 
+/* module names of the plugins which provide the same hwmon chips */
+#define HWMON_PLUGIN "libhwmon"
+#define LIBSENSORS_PLUGIN "liblibsensors"
+
 static gboolean verbose = FALSE;
 
 static void
@@ -52,52 +56,56 @@ on_extension_removed(PeasExtensionSet *set,
   peas_extension_call(exten, "deactivate", application);
 }
 
+/* the hwmon and libsensors plugins both provide every hwmon chip so only
+ * one of them is loaded - libsensors unless the user has chosen to read
+ * hwmon directly or it is not installed */
+static gboolean
+plugin_wanted(PeasEngine *engine,
+              PeasPluginInfo *info,
+              GSettings *settings)
+{
+  const gchar *name = peas_plugin_info_get_module_name(info);
+  gboolean direct = g_settings_get_boolean(settings, "direct-hwmon");
+
+  if (g_strcmp0(name, HWMON_PLUGIN) == 0)
+  {
+    return (direct ||
+            peas_engine_get_plugin_info(engine, LIBSENSORS_PLUGIN) == NULL);
+  }
+  if (g_strcmp0(name, LIBSENSORS_PLUGIN) == 0)
+  {
+    return !direct;
+  }
+  return TRUE;
+}
+
 static void
 on_plugin_list_notify(PeasEngine *engine,
                       GParamSpec *pspec,
-                      gpointer user_data)
+                      GSettings *settings)
 {
   const GList *plugins = peas_engine_get_plugin_list(engine);
   while (plugins != NULL)
   {
     PeasPluginInfo *info = PEAS_PLUGIN_INFO(plugins->data);
-    peas_engine_load_plugin(engine, info);
+    if (plugin_wanted(engine, info, settings))
+    {
+      peas_engine_load_plugin(engine, info);
+    }
+    else if (peas_plugin_info_is_loaded(info))
+    {
+      peas_engine_unload_plugin(engine, info);
+    }
     plugins = plugins->next;
   }
 }
 
 static void
-clear_sensor_icon_cache(void)
+on_direct_hwmon_changed(GSettings *settings,
+                        const gchar *key,
+                        PeasEngine *engine)
 {
-  GDir *dir = NULL;
-  const gchar *filename;
-  gchar *cache_dir = g_build_filename(g_get_user_cache_dir(),
-                                      PACKAGE, "icons", NULL);
-
-  dir = g_dir_open(cache_dir, 0, NULL);
-  if (dir == NULL)
-  {
-    is_error("main", "Failed to open icon cache dir %s\n", cache_dir);
-    goto exit;
-  }
-
-  for (filename = g_dir_read_name(dir);
-       filename != NULL;
-       filename = g_dir_read_name(dir))
-  {
-    gchar *path = g_build_filename(cache_dir, filename, NULL);
-    int ret = g_remove(path);
-    if (ret < 0)
-    {
-      is_error("main", "Error removing icon cache file: %s\n", path);
-    }
-    g_free(path);
-  }
-  g_dir_close(dir);
-
-exit:
-  g_free(cache_dir);
-  return;
+  on_plugin_list_notify(engine, NULL, settings);
 }
 
 static GOptionEntry options[] =
@@ -145,11 +153,12 @@ int main(int argc, char **argv)
     is_log_set_level(IS_LOG_LEVEL_DEBUG);
   }
 
-  /* clear the sensor icon cache directory to use any new icon theme */
-  clear_sensor_icon_cache();
-
   gtk_init(&argc, &argv);
 
+  /* prepare the sensor icon cache in the background for the current icon
+   * theme */
+  sensor_prepare_cache_icons();
+
   if (!g_irepository_require(g_irepository_get_default(), "Peas", "1.0",
                              0, &error))
   {
@@ -158,9 +167,14 @@ int main(int argc, char **argv)
     error = NULL;
   }
 
+  /* make sure we create the application with the default settings */
+  settings = g_settings_new("indicator-sensors.application");
+
   engine = peas_engine_get_default();
   g_signal_connect(engine, "notify::plugin-list",
-                   G_CALLBACK(on_plugin_list_notify), NULL);
+                   G_CALLBACK(on_plugin_list_notify), settings);
+  g_signal_connect(settings, "changed::direct-hwmon",
+                   G_CALLBACK(on_direct_hwmon_changed), engine);
 
   /* add home dir to search path */
   plugin_dir = g_build_filename(g_get_user_config_dir(), PACKAGE,
@@ -175,8 +189,6 @@ int main(int argc, char **argv)
 
   /* init notifications */
   is_notify_init();
-  /* make sure we create the application with the default settings */
-  settings = g_settings_new("indicator-sensors.application");
   show_indicator = g_settings_get_boolean(settings, "show-indicator");
   scale = g_settings_get_int(settings, "temperature-scale");
   application = g_object_new(IS_TYPE_APPLICATION,
@@ -190,6 +202,9 @@ int main(int argc, char **argv)
   g_settings_bind(settings, "show-indicator",
                   application, "show-indicator",
                   G_SETTINGS_BIND_DEFAULT);
+  g_settings_bind(settings, "config-write-delay",
+                  application, "config-write-delay",
+                  G_SETTINGS_BIND_DEFAULT);
 
   /* create extension set and set manager as object */
   set = peas_extension_set_new(engine, PEAS_TYPE_ACTIVATABLE,
@@ -24,8 +24,10 @@
 #include "is-manager.h"
 #include "is-preferences-dialog.h"
 #include "is-sensor-dialog.h"
+#include "is-sensor-config.h"
 #include "is-log.h"
 #include <math.h>
+#include <string.h>
 #include <glib/gi18n.h>
 
 #define DESKTOP_FILENAME PACKAGE ".desktop"
@@ -41,9 +43,19 @@ static void is_application_set_property(GObject *object,
 
 // poll timeout should be less than the alarm timeout / hysteresis to ensure we
 // get at least one more reading in before showing the notification otherwise
-// there is no hysteresis
+// there is no hysteresis - it is the minimum interval between updates of any
+// single sensor, each sensor is otherwise updated as per its update-interval
 #define DEFAULT_POLL_TIMEOUT 4
 
+/* signal enum */
+enum
+{
+  SIGNAL_UPDATE_VALUES,
+  LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL] = {0};
+
 /* properties */
 enum
 {
@@ -52,6 +64,7 @@ enum
   PROP_POLL_TIMEOUT,
   PROP_AUTOSTART,
   PROP_TEMPERATURE_SCALE,
+  PROP_CONFIG_WRITE_DELAY,
   LAST_PROPERTY
 };
 
@@ -63,11 +76,18 @@ struct _IsApplicationPrivate
   IsIndicator *indicator;
   GtkWidget *prefs_dialog;
   guint poll_timeout;
-  glong poll_timeout_id;
+  GSource *poll_source;
+  /* enabled sensors ordered by the time they are next due to be updated, plus
+   * a lookup from sensor to its position in this schedule */
+  GSequence *schedule;
+  GHashTable *scheduled;
+  /* sensors due in the current tick and the batch passed to update-values -
+   * both kept around between ticks to avoid reallocating them */
+  GArray *due;
+  GPtrArray *batch;
   GFileMonitor *monitor;
   IsTemperatureSensorScale temperature_scale;
-  GKeyFile *sensor_config;
-  guint idle_write_id;
+  IsSensorConfig *sensor_config;
 };
 
 static void
@@ -124,33 +144,262 @@ is_application_class_init(IsApplicationClass *klass)
   g_object_class_install_property(gobject_class, PROP_TEMPERATURE_SCALE,
                                   properties[PROP_TEMPERATURE_SCALE]);
 
+  properties[PROP_CONFIG_WRITE_DELAY] = g_param_spec_uint("config-write-delay",
+                                        "config-write-delay property",
+                                        "Milliseconds to batch up sensor config changes before writing them.",
+                                        0, G_MAXUINT,
+                                        IS_SENSOR_CONFIG_DEFAULT_WRITE_DELAY,
+                                        G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+  g_object_class_install_property(gobject_class, PROP_CONFIG_WRITE_DELAY,
+                                  properties[PROP_CONFIG_WRITE_DELAY]);
+
+  /* emitted once per poll with all the sensors which were just updated for a
+   * given plugin, with the first component of their paths as the detail -
+   * ie. a plugin can connect to "update-values::libsensors" to read all its
+   * due sensors in one go instead of handling update-value per sensor */
+  signals[SIGNAL_UPDATE_VALUES] = g_signal_new("update-values",
+                                  G_OBJECT_CLASS_TYPE(klass),
+                                  G_SIGNAL_RUN_LAST | G_SIGNAL_DETAILED,
+                                  0,
+                                  NULL, NULL,
+                                  g_cclosure_marshal_VOID__BOXED,
+                                  G_TYPE_NONE, 1,
+                                  G_TYPE_PTR_ARRAY | G_SIGNAL_TYPE_STATIC_SCOPE);
+}
+
+typedef struct
+{
+  IsSensor *sensor;
+  gint64 due;
+  /* first component of the sensor path which identifies the plugin */
+  GQuark owner;
+} ScheduledSensor;
+
+typedef struct
+{
+  IsSensor *sensor;
+  GQuark owner;
+} DueSensor;
+
+static void
+due_sensor_clear(DueSensor *due)
+{
+  g_object_unref(due->sensor);
+}
+
+static gint
+due_sensor_cmp(const DueSensor *a,
+               const DueSensor *b)
+{
+  return (a->owner < b->owner ? -1 : (a->owner > b->owner ? 1 : 0));
+}
+
+static GQuark
+sensor_owner(IsSensor *sensor)
+{
+  const gchar *path, *sep;
+  gchar *prefix;
+  GQuark owner;
+
+  path = is_sensor_get_path(sensor);
+  sep = strchr(path, '/');
+  if (!sep)
+  {
+    return g_quark_from_string(path);
+  }
+  prefix = g_strndup(path, sep - path);
+  owner = g_quark_from_string(prefix);
+  g_free(prefix);
+  return owner;
+}
+
+static void
+scheduled_sensor_free(ScheduledSensor *scheduled)
+{
+  g_object_unref(scheduled->sensor);
+  g_slice_free(ScheduledSensor, scheduled);
+}
+
+static gint
+scheduled_sensor_cmp(ScheduledSensor *a,
+                     ScheduledSensor *b,
+                     gpointer data)
+{
+  return (a->due < b->due ? -1 : (a->due > b->due ? 1 : 0));
+}
+
+static gint64
+sensor_update_period(IsApplication *self,
+                     IsSensor *sensor)
+{
+  guint interval;
+
+  interval = MAX(is_sensor_get_update_interval(sensor),
+                 self->priv->poll_timeout);
+  return (gint64)MAX(interval, 1) * G_USEC_PER_SEC;
+}
+
+static gint64
+sensor_next_due(IsApplication *self,
+                IsSensor *sensor,
+                gint64 now)
+{
+  gint64 last_update, due;
+
+  last_update = is_sensor_get_last_update(sensor);
+  due = last_update + sensor_update_period(self, sensor);
+  /* never updated or update-value was skipped so try again later */
+  if (!last_update || due <= now)
+  {
+    due = last_update ? now + sensor_update_period(self, sensor) : now;
+  }
+  return due;
+}
+
+/* arm the poll source for whichever sensor is due to be updated next - this
+ * just sets the ready time of our one long-lived source so is allocation
+ * free */
+static void
+schedule_next_update(IsApplication *self)
+{
+  IsApplicationPrivate *priv = self->priv;
+  ScheduledSensor *next;
+
+  if (g_sequence_get_length(priv->schedule) == 0)
+  {
+    g_source_set_ready_time(priv->poll_source, -1);
+    goto out;
+  }
+  next = g_sequence_get(g_sequence_get_begin_iter(priv->schedule));
+  g_source_set_ready_time(priv->poll_source, next->due);
+
+out:
+  return;
+}
+
+static gboolean
+poll_source_dispatch(GSource *source,
+                     GSourceFunc callback,
+                     gpointer user_data)
+{
+  /* don't fire again until rescheduled */
+  g_source_set_ready_time(source, -1);
+  return callback(user_data);
+}
+
+static GSourceFuncs poll_source_funcs =
+{
+  NULL,
+  NULL,
+  poll_source_dispatch,
+  NULL,
+};
+
+/* update all sensors for a single plugin, then hand those which were
+ * actually updated to the plugin in one batch if it wants them */
+static void
+update_sensors_for_owner(IsApplication *self,
+                         DueSensor *sensors,
+                         guint n_sensors,
+                         GQuark owner)
+{
+  IsApplicationPrivate *priv = self->priv;
+  gboolean batched;
+  guint i;
+
+  batched = g_signal_has_handler_pending(self, signals[SIGNAL_UPDATE_VALUES],
+                                         owner, FALSE);
+  /* coalesce all changes to each sensor during this update into a single
+   * changed signal */
+  for (i = 0; i < n_sensors; i++)
+  {
+    is_sensor_freeze_changed(sensors[i].sensor);
+  }
+  g_ptr_array_set_size(priv->batch, 0);
+  for (i = 0; i < n_sensors; i++)
+  {
+    if (is_sensor_update_value(sensors[i].sensor) && batched)
+    {
+      g_ptr_array_add(priv->batch, sensors[i].sensor);
+    }
+  }
+  if (priv->batch->len > 0)
+  {
+    g_signal_emit(self, signals[SIGNAL_UPDATE_VALUES], owner, priv->batch);
+    g_ptr_array_set_size(priv->batch, 0);
+  }
+  for (i = 0; i < n_sensors; i++)
+  {
+    is_sensor_thaw_changed(sensors[i].sensor);
+  }
 }
 
 static gboolean
 update_sensors(IsApplication *self)
 {
   IsApplicationPrivate *priv;
-  GSList *enabled_sensors;
-  gboolean ret;
+  GSequenceIter *iter;
+  ScheduledSensor *scheduled;
+  DueSensor *due;
+  gint64 now;
+  guint i, start;
 
   g_return_val_if_fail(IS_IS_APPLICATION(self), FALSE);
 
   priv = self->priv;
-  enabled_sensors = is_manager_get_enabled_sensors_list(priv->manager);
-  g_slist_foreach(enabled_sensors,
-                  (GFunc)is_sensor_update_value,
-                  NULL);
-  g_slist_foreach(enabled_sensors, (GFunc)g_object_unref, NULL);
-  /* return false if have no sensors left */
-  ret = (g_slist_length(enabled_sensors) > 0);
-  /* only keep going if have sensors to poll */
-  if (!ret)
+
+  /* collect all sensors which are due */
+  now = g_get_monotonic_time();
+  for (iter = g_sequence_get_begin_iter(priv->schedule);
+       !g_sequence_iter_is_end(iter);
+       iter = g_sequence_iter_next(iter))
   {
-    g_source_remove(priv->poll_timeout_id);
-    priv->poll_timeout_id = 0;
+    DueSensor entry;
+
+    scheduled = g_sequence_get(iter);
+    if (scheduled->due > now)
+    {
+      break;
+    }
+    entry.sensor = g_object_ref(scheduled->sensor);
+    entry.owner = scheduled->owner;
+    g_array_append_val(priv->due, entry);
   }
-  g_slist_free(enabled_sensors);
-  return ret;
+
+  /* group by plugin and update each group together */
+  g_array_sort(priv->due, (GCompareFunc)due_sensor_cmp);
+  due = (DueSensor *)(void *)priv->due->data;
+  for (i = 0, start = 0; i <= priv->due->len; i++)
+  {
+    if (i == priv->due->len || due[i].owner != due[start].owner)
+    {
+      if (i > start)
+      {
+        update_sensors_for_owner(self, &due[start], i - start,
+                                 due[start].owner);
+      }
+      start = i;
+    }
+  }
+
+  /* and reschedule them - any may have been disabled whilst being updated */
+  for (i = 0; i < priv->due->len; i++)
+  {
+    iter = g_hash_table_lookup(priv->scheduled, due[i].sensor);
+    if (iter)
+    {
+      scheduled = g_sequence_get(iter);
+      scheduled->due = sensor_next_due(self, due[i].sensor, now);
+      g_sequence_sort_changed(iter,
+                              (GCompareDataFunc)scheduled_sensor_cmp,
+                              NULL);
+    }
+  }
+  g_array_set_size(priv->due, 0);
+
+  schedule_next_update(self);
+  /* keep our source around for next time */
+  return TRUE;
 }
 
 static void
@@ -169,12 +418,19 @@ is_application_init(IsApplication *self)
   IsApplicationPrivate *priv;
   gchar *path;
   GFile *file;
-  GError *error = NULL;
-  gboolean ret;
 
   priv = self->priv = G_TYPE_INSTANCE_GET_PRIVATE(self, IS_TYPE_APPLICATION,
                       IsApplicationPrivate);
   priv->poll_timeout = DEFAULT_POLL_TIMEOUT;
+  priv->schedule = g_sequence_new((GDestroyNotify)scheduled_sensor_free);
+  priv->scheduled = g_hash_table_new(g_direct_hash, g_direct_equal);
+  priv->due = g_array_new(FALSE, FALSE, sizeof(DueSensor));
+  g_array_set_clear_func(priv->due, (GDestroyNotify)due_sensor_clear);
+  priv->batch = g_ptr_array_new();
+  priv->poll_source = g_source_new(&poll_source_funcs, sizeof(GSource));
+  g_source_set_callback(priv->poll_source, (GSourceFunc)update_sensors,
+                        self, NULL);
+  g_source_attach(priv->poll_source, NULL);
   path = g_build_filename(g_get_user_config_dir(), "autostart",
                           DESKTOP_FILENAME, NULL);
   file = g_file_new_for_path(path);
@@ -186,19 +442,9 @@ is_application_init(IsApplication *self)
   g_free(path);
   priv->temperature_scale = IS_TEMPERATURE_SENSOR_SCALE_CELSIUS;
 
-  priv->sensor_config = g_key_file_new();
   path = g_build_filename(g_get_user_config_dir(), PACKAGE,
                           "sensors", NULL);
-  ret = g_key_file_load_from_file(priv->sensor_config,
-                                  path,
-                                  G_KEY_FILE_KEEP_COMMENTS | G_KEY_FILE_KEEP_TRANSLATIONS,
-                                  &error);
-  if (!ret)
-  {
-    is_warning("manager", "Failed to load sensor configs from file %s: %s",
-               path, error->message);
-    g_error_free(error);
-  }
+  priv->sensor_config = is_sensor_config_new(path);
   g_free(path);
 }
 
@@ -225,12 +471,36 @@ is_application_get_property(GObject *object,
     case PROP_TEMPERATURE_SCALE:
       g_value_set_int(value, is_application_get_temperature_scale(self));
       break;
+    case PROP_CONFIG_WRITE_DELAY:
+      g_value_set_uint(value, is_application_get_config_write_delay(self));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
       break;
   }
 }
 
+static void
+sensor_update_interval_notify(IsSensor *sensor,
+                              GParamSpec *pspec,
+                              IsApplication *self)
+{
+  IsApplicationPrivate *priv = self->priv;
+  GSequenceIter *iter;
+  ScheduledSensor *scheduled;
+
+  iter = g_hash_table_lookup(priv->scheduled, sensor);
+  if (iter)
+  {
+    scheduled = g_sequence_get(iter);
+    scheduled->due = sensor_next_due(self, sensor, g_get_monotonic_time());
+    g_sequence_sort_changed(iter,
+                            (GCompareDataFunc)scheduled_sensor_cmp,
+                            NULL);
+    schedule_next_update(self);
+  }
+}
+
 static void
 sensor_enabled(IsManager *manager,
                IsSensor *sensor,
@@ -238,15 +508,26 @@ sensor_enabled(IsManager *manager,
                IsApplication *self)
 {
   IsApplicationPrivate *priv = self->priv;
+  ScheduledSensor *scheduled;
+  GSequenceIter *iter;
 
-  /* get sensor to update and start polling if not already running */
-  is_sensor_update_value(sensor);
-  if (!priv->poll_timeout_id)
+  if (g_hash_table_lookup(priv->scheduled, sensor))
   {
-    priv->poll_timeout_id = g_timeout_add_seconds(priv->poll_timeout,
-                            (GSourceFunc)update_sensors,
-                            self);
+    return;
   }
+
+  /* get sensor to update as soon as possible */
+  scheduled = g_slice_new0(ScheduledSensor);
+  scheduled->sensor = g_object_ref(sensor);
+  scheduled->due = g_get_monotonic_time();
+  scheduled->owner = sensor_owner(sensor);
+  iter = g_sequence_insert_sorted(priv->schedule, scheduled,
+                                  (GCompareDataFunc)scheduled_sensor_cmp,
+                                  NULL);
+  g_hash_table_insert(priv->scheduled, sensor, iter);
+  g_signal_connect(sensor, "notify::update-interval",
+                   G_CALLBACK(sensor_update_interval_notify), self);
+  schedule_next_update(self);
 }
 
 static void
@@ -255,11 +536,17 @@ sensor_disabled(IsManager *manager,
                 IsApplication *self)
 {
   IsApplicationPrivate *priv = self->priv;
+  GSequenceIter *iter;
 
-  if (!is_manager_get_num_enabled_sensors(priv->manager))
+  iter = g_hash_table_lookup(priv->scheduled, sensor);
+  if (iter)
   {
-    g_source_remove(priv->poll_timeout_id);
-    priv->poll_timeout_id = 0;
+    g_signal_handlers_disconnect_by_func(sensor,
+                                         sensor_update_interval_notify,
+                                         self);
+    g_hash_table_remove(priv->scheduled, sensor);
+    g_sequence_remove(iter);
+    schedule_next_update(self);
   }
 }
 
@@ -273,10 +560,10 @@ restore_sensor_config(IsApplication *self,
   IsSensorAlarmMode alarm_mode;
   GError *error = NULL;
 
-  label = g_key_file_get_string(priv->sensor_config,
-                                is_sensor_get_path(sensor),
-                                "label",
-                                &error);
+  label = is_sensor_config_get_string(priv->sensor_config,
+                                      is_sensor_get_path(sensor),
+                                      "label",
+                                      &error);
   if (label)
   {
     is_sensor_set_label(sensor, label);
@@ -286,40 +573,40 @@ restore_sensor_config(IsApplication *self,
 
   /* restore alarm mode before alarm value so we don't accidentally
      trigger an alarm just before we might disable it */
-  alarm_mode = g_key_file_get_int64(priv->sensor_config,
-                                    is_sensor_get_path(sensor),
-                                    "alarm-mode",
-                                    &error);
+  alarm_mode = is_sensor_config_get_int64(priv->sensor_config,
+                                          is_sensor_get_path(sensor),
+                                          "alarm-mode",
+                                          &error);
   if (!error)
   {
     is_sensor_set_alarm_mode(sensor, alarm_mode);
   }
   g_clear_error(&error);
 
-  alarm_value = g_key_file_get_double(priv->sensor_config,
-                                      is_sensor_get_path(sensor),
-                                      "alarm-value",
-                                      &error);
+  alarm_value = is_sensor_config_get_double(priv->sensor_config,
+                                            is_sensor_get_path(sensor),
+                                            "alarm-value",
+                                            &error);
   if (!error)
   {
     is_sensor_set_alarm_value(sensor, alarm_value);
   }
   g_clear_error(&error);
 
-  low_value = g_key_file_get_double(priv->sensor_config,
-                                    is_sensor_get_path(sensor),
-                                    "low-value",
-                                    &error);
+  low_value = is_sensor_config_get_double(priv->sensor_config,
+                                          is_sensor_get_path(sensor),
+                                          "low-value",
+                                          &error);
   if (!error)
   {
     is_sensor_set_low_value(sensor, low_value);
   }
   g_clear_error(&error);
 
-  high_value = g_key_file_get_double(priv->sensor_config,
-                                     is_sensor_get_path(sensor),
-                                     "high-value",
-                                     &error);
+  high_value = is_sensor_config_get_double(priv->sensor_config,
+                                           is_sensor_get_path(sensor),
+                                           "high-value",
+                                           &error);
   if (!error)
   {
     is_sensor_set_high_value(sensor, high_value);
@@ -327,46 +614,6 @@ restore_sensor_config(IsApplication *self,
   g_clear_error(&error);
 }
 
-static gboolean
-write_out_sensor_config(IsApplication *self)
-{
-  IsApplicationPrivate *priv;
-  gchar *data, *path;
-  gsize len;
-  GError *error = NULL;
-  gboolean ret;
-
-  priv = self->priv;
-  if (!priv->idle_write_id)
-  {
-    is_warning("application", "Not writing out sensor config as has already occurred");
-    goto out;
-  }
-
-  /* ensure directory exists */
-  path = g_build_filename(g_get_user_config_dir(), PACKAGE, NULL);
-  g_mkdir_with_parents(path, 0755);
-  g_free(path);
-
-  data = g_key_file_to_data(self->priv->sensor_config, &len, NULL);
-  path = g_build_filename(g_get_user_config_dir(), PACKAGE,
-                          "sensors", NULL);
-  ret = g_file_set_contents(path, data, len, &error);
-  if (!ret)
-  {
-    is_warning("application", "Failed to write sensor config to file %s: %s",
-               path, error->message);
-    g_error_free(error);
-  }
-  g_free(path);
-  g_free(data);
-
-  /* make sure we are not called again as an idle callback */
-out:
-  priv->idle_write_id = 0;
-  return FALSE;
-}
-
 static void
 sensor_label_notify(IsSensor *sensor,
                     GParamSpec *pspec,
@@ -374,15 +621,14 @@ sensor_label_notify(IsSensor *sensor,
 {
   IsApplicationPrivate *priv = self->priv;
 
-  g_key_file_set_string(priv->sensor_config,
-                        is_sensor_get_path(sensor),
-                        "label",
-                        is_sensor_get_label(sensor));
-  if (!priv->idle_write_id)
+  if (is_sensor_get_config_frozen(sensor))
   {
-    priv->idle_write_id = g_idle_add((GSourceFunc)write_out_sensor_config,
-                                     self);
+    return;
   }
+  is_sensor_config_set_string(priv->sensor_config,
+                              is_sensor_get_path(sensor),
+                              "label",
+                              is_sensor_get_label(sensor));
 }
 
 static void
@@ -392,15 +638,14 @@ sensor_alarm_value_notify(IsSensor *sensor,
 {
   IsApplicationPrivate *priv = self->priv;
 
-  g_key_file_set_double(priv->sensor_config,
-                        is_sensor_get_path(sensor),
-                        "alarm-value",
-                        is_sensor_get_alarm_value(sensor));
-  if (!priv->idle_write_id)
+  if (is_sensor_get_config_frozen(sensor))
   {
-    priv->idle_write_id = g_idle_add((GSourceFunc)write_out_sensor_config,
-                                     self);
+    return;
   }
+  is_sensor_config_set_double(priv->sensor_config,
+                              is_sensor_get_path(sensor),
+                              "alarm-value",
+                              is_sensor_get_alarm_value(sensor));
 }
 
 static void
@@ -410,15 +655,14 @@ sensor_alarm_mode_notify(IsSensor *sensor,
 {
   IsApplicationPrivate *priv = self->priv;
 
-  g_key_file_set_int64(priv->sensor_config,
-                       is_sensor_get_path(sensor),
-                       "alarm-mode",
-                       is_sensor_get_alarm_mode(sensor));
-  if (!priv->idle_write_id)
+  if (is_sensor_get_config_frozen(sensor))
   {
-    priv->idle_write_id = g_idle_add((GSourceFunc)write_out_sensor_config,
-                                     self);
+    return;
   }
+  is_sensor_config_set_int64(priv->sensor_config,
+                             is_sensor_get_path(sensor),
+                             "alarm-mode",
+                             is_sensor_get_alarm_mode(sensor));
 }
 
 static void
@@ -428,15 +672,14 @@ sensor_low_value_notify(IsSensor *sensor,
 {
   IsApplicationPrivate *priv = self->priv;
 
-  g_key_file_set_double(priv->sensor_config,
-                        is_sensor_get_path(sensor),
-                        "low-value",
-                        is_sensor_get_low_value(sensor));
-  if (!priv->idle_write_id)
+  if (is_sensor_get_config_frozen(sensor))
   {
-    priv->idle_write_id = g_idle_add((GSourceFunc)write_out_sensor_config,
-                                     self);
+    return;
   }
+  is_sensor_config_set_double(priv->sensor_config,
+                              is_sensor_get_path(sensor),
+                              "low-value",
+                              is_sensor_get_low_value(sensor));
 }
 
 static void
@@ -446,15 +689,14 @@ sensor_high_value_notify(IsSensor *sensor,
 {
   IsApplicationPrivate *priv = self->priv;
 
-  g_key_file_set_double(priv->sensor_config,
-                        is_sensor_get_path(sensor),
-                        "high-value",
-                        is_sensor_get_high_value(sensor));
-  if (!priv->idle_write_id)
+  if (is_sensor_get_config_frozen(sensor))
   {
-    priv->idle_write_id = g_idle_add((GSourceFunc)write_out_sensor_config,
-                                     self);
+    return;
   }
+  is_sensor_config_set_double(priv->sensor_config,
+                              is_sensor_get_path(sensor),
+                              "high-value",
+                              is_sensor_get_high_value(sensor));
 }
 
 static void
@@ -538,6 +780,9 @@ is_application_set_property(GObject *object,
       is_application_set_temperature_scale(self,
                                            g_value_get_int(value));
       break;
+    case PROP_CONFIG_WRITE_DELAY:
+      is_application_set_config_write_delay(self, g_value_get_uint(value));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
       break;
@@ -550,10 +795,41 @@ is_application_dispose(GObject *object)
   IsApplication *self = (IsApplication *)object;
   IsApplicationPrivate *priv = self->priv;
 
-  if (priv->poll_timeout_id)
+  if (priv->poll_source)
+  {
+    g_source_destroy(priv->poll_source);
+    g_source_unref(priv->poll_source);
+    priv->poll_source = NULL;
+  }
+  if (priv->scheduled)
+  {
+    GHashTableIter iter;
+    gpointer sensor;
+
+    g_hash_table_iter_init(&iter, priv->scheduled);
+    while (g_hash_table_iter_next(&iter, &sensor, NULL))
+    {
+      g_signal_handlers_disconnect_by_func(sensor,
+                                           sensor_update_interval_notify,
+                                           self);
+    }
+    g_hash_table_destroy(priv->scheduled);
+    priv->scheduled = NULL;
+  }
+  if (priv->schedule)
+  {
+    g_sequence_free(priv->schedule);
+    priv->schedule = NULL;
+  }
+  if (priv->due)
   {
-    g_source_remove(priv->poll_timeout_id);
-    priv->poll_timeout_id = 0;
+    g_array_free(priv->due, TRUE);
+    priv->due = NULL;
+  }
+  if (priv->batch)
+  {
+    g_ptr_array_free(priv->batch, TRUE);
+    priv->batch = NULL;
   }
   g_object_unref(priv->monitor);
 
@@ -572,6 +848,8 @@ is_application_finalize(GObject *object)
   IsApplicationPrivate *priv = self->priv;
 
   g_object_unref(priv->manager);
+  /* flushes any pending changes */
+  is_sensor_config_free(priv->sensor_config);
 
   G_OBJECT_CLASS(is_application_parent_class)->finalize(object);
 }
@@ -624,14 +902,23 @@ is_application_set_poll_timeout(IsApplication *self,
   priv = self->priv;
   if (priv->poll_timeout != poll_timeout)
   {
+    GSequenceIter *iter;
+    gint64 now;
+
     priv->poll_timeout = poll_timeout;
-    if (priv->poll_timeout_id)
+    /* recalculate when each sensor is next due */
+    now = g_get_monotonic_time();
+    for (iter = g_sequence_get_begin_iter(priv->schedule);
+         !g_sequence_iter_is_end(iter);
+         iter = g_sequence_iter_next(iter))
     {
-      g_source_remove(priv->poll_timeout_id);
-      priv->poll_timeout_id = g_timeout_add_seconds(priv->poll_timeout,
-                              (GSourceFunc)update_sensors,
-                              self);
+      ScheduledSensor *scheduled = g_sequence_get(iter);
+      scheduled->due = sensor_next_due(self, scheduled->sensor, now);
     }
+    g_sequence_sort(priv->schedule,
+                    (GCompareDataFunc)scheduled_sensor_cmp,
+                    NULL);
+    schedule_next_update(self);
     g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_POLL_TIMEOUT]);
   }
 }
@@ -831,6 +1118,31 @@ void is_application_set_temperature_scale(IsApplication *self,
   }
 }
 
+guint
+is_application_get_config_write_delay(IsApplication *self)
+{
+  g_return_val_if_fail(IS_IS_APPLICATION(self), 0);
+
+  return is_sensor_config_get_write_delay(self->priv->sensor_config);
+}
+
+void
+is_application_set_config_write_delay(IsApplication *self,
+                                      guint write_delay)
+{
+  IsApplicationPrivate *priv;
+
+  g_return_if_fail(IS_IS_APPLICATION(self));
+
+  priv = self->priv;
+
+  if (is_sensor_config_get_write_delay(priv->sensor_config) != write_delay)
+  {
+    is_sensor_config_set_write_delay(priv->sensor_config, write_delay);
+    g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_CONFIG_WRITE_DELAY]);
+  }
+}
+
 void is_application_show_preferences(IsApplication *self)
 {
   IsApplicationPrivate *priv;
@@ -874,6 +1186,9 @@ void is_application_show_about(IsApplication *self)
 void is_application_quit(IsApplication *self)
 {
   g_return_if_fail(IS_IS_APPLICATION(self));
+  /* plugins hold references on us so we are never finalized - make sure
+   * any pending config changes are saved */
+  is_sensor_config_sync(self->priv->sensor_config);
   gtk_main_quit();
 }
 
@@ -72,6 +72,9 @@ void is_application_set_autostart(IsApplication *self, gboolean autostart);
 IsTemperatureSensorScale is_application_get_temperature_scale(IsApplication *self);
 void is_application_set_temperature_scale(IsApplication *self,
     IsTemperatureSensorScale scale);
+guint is_application_get_config_write_delay(IsApplication *self);
+void is_application_set_config_write_delay(IsApplication *self,
+                                           guint write_delay);
 void is_application_show_preferences(IsApplication *self);
 void is_application_show_about(IsApplication *self);
 void is_application_quit(IsApplication *self);
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2011-2019 Alex Murray <murray.alex@gmail.com>
+ *
+ * indicator-sensors is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * indicator-sensors is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with indicator-sensors.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "is-current-sensor.h"
+#include <glib/gi18n.h>
+
+G_DEFINE_TYPE(IsCurrentSensor, is_current_sensor, IS_TYPE_SENSOR);
+
+static void
+is_current_sensor_class_init(IsCurrentSensorClass *klass)
+{
+  /* nothing to do */
+}
+
+static void
+is_current_sensor_init(IsCurrentSensor *self)
+{
+  /* nothing to do */
+}
+
+IsSensor *
+is_current_sensor_new(const gchar *path)
+{
+  return g_object_new(IS_TYPE_CURRENT_SENSOR,
+                      "path", path,
+                      "value", IS_SENSOR_VALUE_UNSET,
+                      /* translators: A is the unit for current in amperes */
+                      "units", _(" A"),
+                      "digits", 2,
+                      "low-value", 0.0,
+                      "high-value", 10.0,
+                      "icon", IS_STOCK_CHIP,
+                      NULL);
+}
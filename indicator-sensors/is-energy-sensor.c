@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2011-2019 Alex Murray <murray.alex@gmail.com>
+ *
+ * indicator-sensors is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * indicator-sensors is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with indicator-sensors.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "is-energy-sensor.h"
+#include <glib/gi18n.h>
+
+/* an energy sensor shows the power used - ie. the rate of change of an
+ * energy counter in micro-joules between successive readings */
+G_DEFINE_TYPE(IsEnergySensor, is_energy_sensor, IS_TYPE_POWER_SENSOR);
+
+struct _IsEnergySensorPrivate
+{
+  /* value at which the counter wraps back to zero, or 0 if unknown */
+  guint64 max_energy_range;
+  guint64 last_energy;
+  /* monotonic time in usecs of last_energy, or 0 if none yet */
+  gint64 last_timestamp;
+};
+
+static void
+is_energy_sensor_class_init(IsEnergySensorClass *klass)
+{
+  g_type_class_add_private(klass, sizeof(IsEnergySensorPrivate));
+}
+
+static void
+is_energy_sensor_init(IsEnergySensor *self)
+{
+  IsEnergySensorPrivate *priv =
+    G_TYPE_INSTANCE_GET_PRIVATE(self, IS_TYPE_ENERGY_SENSOR,
+                                IsEnergySensorPrivate);
+
+  self->priv = priv;
+}
+
+IsSensor *
+is_energy_sensor_new(const gchar *path)
+{
+  /* shown as power so same defaults as is_power_sensor_new() */
+  return g_object_new(IS_TYPE_ENERGY_SENSOR,
+                      "path", path,
+                      "value", IS_SENSOR_VALUE_UNSET,
+                      /* translators: W is the unit for power in watts */
+                      "units", _(" W"),
+                      "digits", 1,
+                      "low-value", 0.0,
+                      "high-value", 200.0,
+                      "icon", IS_STOCK_CHIP,
+                      NULL);
+}
+
+guint64
+is_energy_sensor_get_max_energy_range(IsEnergySensor *self)
+{
+  g_return_val_if_fail(IS_IS_ENERGY_SENSOR(self), 0);
+  return self->priv->max_energy_range;
+}
+
+void
+is_energy_sensor_set_max_energy_range(IsEnergySensor *self,
+                                      guint64 max_energy_range)
+{
+  g_return_if_fail(IS_IS_ENERGY_SENSOR(self));
+  self->priv->max_energy_range = max_energy_range;
+}
+
+/* takes a new reading of the energy counter in micro-joules taken at
+ * timestamp (monotonic time in usecs) and updates the value with the
+ * average power in watts since the previous reading */
+void
+is_energy_sensor_set_energy(IsEnergySensor *self,
+                            guint64 energy,
+                            gint64 timestamp)
+{
+  IsEnergySensorPrivate *priv;
+  guint64 delta;
+
+  g_return_if_fail(IS_IS_ENERGY_SENSOR(self));
+
+  priv = self->priv;
+
+  if (!priv->last_timestamp || timestamp <= priv->last_timestamp)
+  {
+    goto out;
+  }
+  if (energy >= priv->last_energy)
+  {
+    delta = energy - priv->last_energy;
+  }
+  else if (priv->max_energy_range >= priv->last_energy)
+  {
+    /* counter has wrapped */
+    delta = (priv->max_energy_range - priv->last_energy) + energy;
+  }
+  else
+  {
+    /* counter has been reset (or wrapped at an unknown range) so can't
+     * tell how much was used - just start again from here */
+    goto out;
+  }
+  /* micro-joules per microsecond is watts */
+  is_sensor_set_value(IS_SENSOR(self),
+                      (gdouble)delta / (gdouble)(timestamp - priv->last_timestamp));
+
+out:
+  priv->last_energy = energy;
+  priv->last_timestamp = timestamp;
+}
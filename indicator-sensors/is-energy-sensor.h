@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2011-2019 Alex Murray <murray.alex@gmail.com>
+ *
+ * indicator-sensors is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * indicator-sensors is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with indicator-sensors.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __IS_ENERGY_SENSOR_H__
+#define __IS_ENERGY_SENSOR_H__
+
+#include "is-power-sensor.h"
+
+
+G_BEGIN_DECLS
+
+#define IS_TYPE_ENERGY_SENSOR    \
+  (is_energy_sensor_get_type())
+#define IS_ENERGY_SENSOR(obj)        \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),      \
+                              IS_TYPE_ENERGY_SENSOR, \
+                              IsEnergySensor))
+#define IS_ENERGY_SENSOR_CLASS(klass)      \
+  (G_TYPE_CHECK_CLASS_CAST((klass),     \
+                           IS_TYPE_ENERGY_SENSOR,  \
+                           IsEnergySensorClass))
+#define IS_IS_ENERGY_SENSOR(obj)                                   \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),        \
+                              IS_TYPE_ENERGY_SENSOR))
+#define IS_IS_ENERGY_SENSOR_CLASS(klass)     \
+  (G_TYPE_CHECK_CLASS_TYPE((klass),     \
+                           IS_TYPE_ENERGY_SENSOR))
+#define IS_ENERGY_SENSOR_GET_CLASS(obj)      \
+  (G_TYPE_INSTANCE_GET_CLASS((obj),     \
+                             IS_TYPE_ENERGY_SENSOR,  \
+                             IsEnergySensorClass))
+
+typedef struct _IsEnergySensor      IsEnergySensor;
+typedef struct _IsEnergySensorClass IsEnergySensorClass;
+typedef struct _IsEnergySensorPrivate IsEnergySensorPrivate;
+
+struct _IsEnergySensorClass
+{
+  IsPowerSensorClass parent_class;
+};
+
+struct _IsEnergySensor
+{
+  IsPowerSensor parent;
+  IsEnergySensorPrivate *priv;
+};
+
+GType is_energy_sensor_get_type(void) G_GNUC_CONST;
+IsSensor *is_energy_sensor_new(const gchar *path);
+guint64 is_energy_sensor_get_max_energy_range(IsEnergySensor *sensor);
+void is_energy_sensor_set_max_energy_range(IsEnergySensor *sensor,
+    guint64 max_energy_range);
+void is_energy_sensor_set_energy(IsEnergySensor *sensor,
+                                 guint64 energy,
+                                 gint64 timestamp);
+
+G_END_DECLS
+
+#endif /* __IS_ENERGY_SENSOR_H__ */
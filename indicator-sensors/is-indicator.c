@@ -509,16 +509,31 @@ update_sensor_menu_item_label(IsIndicator *self,
 
 }
 
+/* properties which are displayed for each sensor */
+#define SENSOR_DISPLAY_CHANGED_FLAGS (IS_SENSOR_CHANGED_VALUE |          \
+                                      IS_SENSOR_CHANGED_LABEL |          \
+                                      IS_SENSOR_CHANGED_UNITS |          \
+                                      IS_SENSOR_CHANGED_DIGITS |         \
+                                      IS_SENSOR_CHANGED_ALARMED |        \
+                                      IS_SENSOR_CHANGED_LOW_VALUE |      \
+                                      IS_SENSOR_CHANGED_HIGH_VALUE |     \
+                                      IS_SENSOR_CHANGED_ICON_PATH)
+
 static void
-sensor_notify(IsSensor *sensor,
-              GParamSpec *psec,
-              IsIndicator *self)
+sensor_changed(IsSensor *sensor,
+               guint changed,
+               IsIndicator *self)
 {
   GtkMenuItem *menu_item;
 
   g_return_if_fail(IS_IS_SENSOR(sensor));
   g_return_if_fail(IS_IS_INDICATOR(self));
 
+  if (!(changed & SENSOR_DISPLAY_CHANGED_FLAGS))
+  {
+    return;
+  }
+
   menu_item = GTK_MENU_ITEM(g_object_get_data(G_OBJECT(sensor),
                             "menu-item"));
   if (menu_item)
@@ -546,7 +561,7 @@ _sensor_disabled(IsSensor *sensor,
   g_object_set_data(G_OBJECT(sensor), "menu-item", NULL);
 
   g_signal_handlers_disconnect_by_func(sensor,
-                                       sensor_notify,
+                                       sensor_changed,
                                        self);
 }
 
@@ -624,20 +639,8 @@ sensor_enabled(IsManager *manager,
     is_debug("indicator", "Creating menu item for newly enabled sensor %s",
              is_sensor_get_path(sensor));
 
-    g_signal_connect(sensor, "notify::value",
-                     G_CALLBACK(sensor_notify),
-                     self);
-    g_signal_connect(sensor, "notify::label",
-                     G_CALLBACK(sensor_notify),
-                     self);
-    g_signal_connect(sensor, "notify::alarmed",
-                     G_CALLBACK(sensor_notify),
-                     self);
-    g_signal_connect(sensor, "notify::low-value",
-                     G_CALLBACK(sensor_notify),
-                     self);
-    g_signal_connect(sensor, "notify::high-value",
-                     G_CALLBACK(sensor_notify),
+    g_signal_connect(sensor, "changed",
+                     G_CALLBACK(sensor_changed),
                      self);
     /* add a menu entry for this sensor */
     menu = is_indicator_get_menu(self);
@@ -46,6 +46,7 @@ enum
   SIGNAL_SENSOR_ENABLED,
   SIGNAL_SENSOR_DISABLED,
   SIGNAL_SENSOR_POSITION_CHANGED,
+  SIGNAL_POSITIONS_CHANGED,
   LAST_SIGNAL
 };
 
@@ -64,7 +65,15 @@ struct _IsManagerPrivate
 {
   IsStore *store;
   GTree *enabled_paths;
-  GSList *enabled_list;
+  /* enabled sensors in store order plus an index from each sensor to its
+   * position in the sequence */
+  GSequence *enabled;
+  GHashTable *enabled_iters;
+  /* while a bulk update is in progress per-sensor position changes are not
+   * signalled, instead positions-changed is emitted once at the end */
+  guint bulk_count;
+  gboolean positions_changed;
+  gboolean enabled_sensors_changed;
 };
 
 static void
@@ -134,6 +143,14 @@ is_manager_class_init(IsManagerClass *klass)
       G_TYPE_NONE, 2,
       IS_TYPE_SENSOR,
       G_TYPE_INT);
+
+  signals[SIGNAL_POSITIONS_CHANGED] = g_signal_new("positions-changed",
+                                      G_OBJECT_CLASS_TYPE(klass),
+                                      G_SIGNAL_RUN_LAST,
+                                      0,
+                                      NULL, NULL,
+                                      g_cclosure_marshal_VOID__VOID,
+                                      G_TYPE_NONE, 0);
 }
 
 static void sensor_label_edited(GtkCellRendererText *renderer,
@@ -165,19 +182,91 @@ sensor_cmp_by_path(IsSensor *a, IsSensor *b, IsManager *self)
 {
   IsManagerPrivate *priv;
   GtkTreeIter a_iter, b_iter;
-  GtkTreePath *a_path, *b_path;
-  gint ret;
 
   priv = self->priv;
 
   is_store_get_iter_for_sensor(priv->store, a, &a_iter);
   is_store_get_iter_for_sensor(priv->store, b, &b_iter);
-  a_path = gtk_tree_model_get_path(GTK_TREE_MODEL(priv->store), &a_iter);
-  b_path = gtk_tree_model_get_path(GTK_TREE_MODEL(priv->store), &b_iter);
-  ret = gtk_tree_path_compare(a_path, b_path);
-  gtk_tree_path_free(b_path);
-  gtk_tree_path_free(a_path);
-  return ret;
+  return is_store_compare_iters(priv->store, &a_iter, &b_iter);
+}
+
+/* signal position changed for all enabled sensors from iter onwards */
+static void
+emit_positions_changed_from(IsManager *self,
+                            GSequenceIter *iter)
+{
+  IsManagerPrivate *priv;
+  gint i;
+
+  priv = self->priv;
+
+  if (g_sequence_iter_is_end(iter))
+  {
+    return;
+  }
+  if (priv->bulk_count > 0)
+  {
+    priv->positions_changed = TRUE;
+    return;
+  }
+  for (i = g_sequence_iter_get_position(iter);
+       !g_sequence_iter_is_end(iter);
+       iter = g_sequence_iter_next(iter), i++)
+  {
+    g_signal_emit(self, signals[SIGNAL_SENSOR_POSITION_CHANGED], 0,
+                  g_sequence_get(iter), i);
+  }
+}
+
+static void
+enabled_sensors_changed(IsManager *self)
+{
+  IsManagerPrivate *priv;
+
+  priv = self->priv;
+
+  if (priv->bulk_count > 0)
+  {
+    priv->enabled_sensors_changed = TRUE;
+    return;
+  }
+  g_object_notify_by_pspec(G_OBJECT(self),
+                           properties[PROP_ENABLED_SENSORS]);
+}
+
+/* batch up enabling / disabling of many sensors so that the resulting
+ * position changes and enabled-sensors notify are only signalled once when
+ * the outermost end_bulk_update() is called */
+static void
+begin_bulk_update(IsManager *self)
+{
+  self->priv->bulk_count++;
+}
+
+static void
+end_bulk_update(IsManager *self)
+{
+  IsManagerPrivate *priv;
+
+  priv = self->priv;
+
+  g_return_if_fail(priv->bulk_count > 0);
+
+  if (--priv->bulk_count > 0)
+  {
+    return;
+  }
+  if (priv->positions_changed)
+  {
+    priv->positions_changed = FALSE;
+    g_signal_emit(self, signals[SIGNAL_POSITIONS_CHANGED], 0);
+  }
+  if (priv->enabled_sensors_changed)
+  {
+    priv->enabled_sensors_changed = FALSE;
+    g_object_notify_by_pspec(G_OBJECT(self),
+                             properties[PROP_ENABLED_SENSORS]);
+  }
 }
 
 static void
@@ -186,30 +275,27 @@ enable_sensor(IsManager *self,
               IsSensor *sensor)
 {
   IsManagerPrivate *priv;
-  guint i;
+  GSequenceIter *seq_iter;
 
   priv = self->priv;
 
   is_store_set_enabled(priv->store, iter, TRUE);
-  priv->enabled_list = g_slist_insert_sorted_with_data(priv->enabled_list,
-                       sensor,
-                       (GCompareDataFunc)sensor_cmp_by_path,
-                       self);
-  i = g_slist_index(priv->enabled_list, sensor);
-  g_signal_emit(self, signals[SIGNAL_SENSOR_ENABLED], 0, sensor,
-                i);
-  /* signal position changed for all following sensors */
-  while (++i < g_slist_length(priv->enabled_list))
+  if (!g_hash_table_lookup(priv->enabled_iters, sensor))
   {
-    g_signal_emit(self, signals[SIGNAL_SENSOR_POSITION_CHANGED], 0,
-                  g_slist_nth_data(priv->enabled_list, i), i);
+    seq_iter = g_sequence_insert_sorted(priv->enabled, sensor,
+                                        (GCompareDataFunc)sensor_cmp_by_path,
+                                        self);
+    g_hash_table_insert(priv->enabled_iters, sensor, seq_iter);
+    g_signal_emit(self, signals[SIGNAL_SENSOR_ENABLED], 0, sensor,
+                  g_sequence_iter_get_position(seq_iter));
+    /* signal position changed for all following sensors */
+    emit_positions_changed_from(self, g_sequence_iter_next(seq_iter));
   }
   if (!g_tree_lookup(priv->enabled_paths, is_sensor_get_path(sensor)))
   {
     gchar *path = g_strdup(is_sensor_get_path(sensor));
     g_tree_insert(priv->enabled_paths, path, path);
-    g_object_notify_by_pspec(G_OBJECT(self),
-                             properties[PROP_ENABLED_SENSORS]);
+    enabled_sensors_changed(self);
   }
 }
 
@@ -219,24 +305,22 @@ _disable_sensor(IsManager *self,
                 IsSensor *sensor)
 {
   IsManagerPrivate *priv;
-  guint i;
+  GSequenceIter *seq_iter, *next;
 
   priv = self->priv;
 
-  i = g_slist_index(priv->enabled_list, sensor);
   is_store_set_enabled(priv->store, iter, FALSE);
-  priv->enabled_list = g_slist_remove(priv->enabled_list,
-                                      sensor);
-  g_signal_emit(self, signals[SIGNAL_SENSOR_DISABLED], 0, sensor);
-  /* signal position changed for all following sensors - the first sensor
-   * following this one we just removed is at its location so no need to
-   * preincrement the first time */
-  while (i < g_slist_length(priv->enabled_list))
+  seq_iter = g_hash_table_lookup(priv->enabled_iters, sensor);
+  if (!seq_iter)
   {
-    g_signal_emit(self, signals[SIGNAL_SENSOR_POSITION_CHANGED], 0,
-                  g_slist_nth_data(priv->enabled_list, i), i);
-    i++;
+    return;
   }
+  next = g_sequence_iter_next(seq_iter);
+  g_hash_table_remove(priv->enabled_iters, sensor);
+  g_sequence_remove(seq_iter);
+  g_signal_emit(self, signals[SIGNAL_SENSOR_DISABLED], 0, sensor);
+  /* signal position changed for all following sensors */
+  emit_positions_changed_from(self, next);
 }
 
 static void
@@ -250,8 +334,7 @@ disable_sensor(IsManager *self,
 
   ret = g_tree_remove(self->priv->enabled_paths, is_sensor_get_path(sensor));
   g_assert(ret);
-  g_object_notify_by_pspec(G_OBJECT(self),
-                           properties[PROP_ENABLED_SENSORS]);
+  enabled_sensors_changed(self);
 }
 
 static void sensor_toggled(GtkCellRendererToggle *renderer,
@@ -303,6 +386,8 @@ is_manager_init(IsManager *self)
   self->priv = priv;
   priv->enabled_paths = g_tree_new_full((GCompareDataFunc)g_strcmp0, NULL,
                                         g_free, NULL);
+  priv->enabled = g_sequence_new(NULL);
+  priv->enabled_iters = g_hash_table_new(g_direct_hash, g_direct_equal);
   priv->store = is_store_new();
   gtk_tree_view_set_model(GTK_TREE_VIEW(self),
                           GTK_TREE_MODEL(priv->store));
@@ -400,7 +485,8 @@ is_manager_finalize(GObject *object)
   IsManagerPrivate *priv = self->priv;
 
   g_tree_unref(priv->enabled_paths);
-  g_slist_free(priv->enabled_list);
+  g_hash_table_destroy(priv->enabled_iters);
+  g_sequence_free(priv->enabled);
 
   G_OBJECT_CLASS(is_manager_parent_class)->finalize(object);
 }
@@ -448,6 +534,7 @@ is_manager_remove_paths_with_prefix(IsManager *self,
   gboolean ret = FALSE;
 
   sensors = is_manager_get_all_sensors_list(self);
+  begin_bulk_update(self);
   for (_list = sensors;
        _list != NULL;
        _list = _list->next)
@@ -461,6 +548,7 @@ is_manager_remove_paths_with_prefix(IsManager *self,
 
     g_object_unref(sensor);
   }
+  end_bulk_update(self);
   g_slist_free(sensors);
 
   return ret;
@@ -515,28 +603,51 @@ GSList *
 is_manager_get_enabled_sensors_list(IsManager *self)
 {
   IsManagerPrivate *priv;
-  GSList *_list, *list = NULL;
+  GSequenceIter *iter;
+  GSList *list = NULL;
 
   g_return_val_if_fail(IS_IS_MANAGER(self), NULL);
   priv = self->priv;
 
-  for (_list = priv->enabled_list;
-       _list != NULL;
-       _list = _list->next)
+  for (iter = g_sequence_get_begin_iter(priv->enabled);
+       !g_sequence_iter_is_end(iter);
+       iter = g_sequence_iter_next(iter))
   {
-    list = g_slist_prepend(list, g_object_ref(_list->data));
+    list = g_slist_prepend(list, g_object_ref(g_sequence_get(iter)));
   }
   list = g_slist_reverse(list);
   return list;
 }
 
+/* calls func for each enabled sensor in order without copying or taking a
+ * reference on any - func must not enable or disable any sensors */
+void
+is_manager_foreach_enabled_sensor(IsManager *self,
+                                  GFunc func,
+                                  gpointer user_data)
+{
+  IsManagerPrivate *priv;
+
+  g_return_if_fail(IS_IS_MANAGER(self));
+  g_return_if_fail(func != NULL);
+
+  priv = self->priv;
+
+  g_sequence_foreach(priv->enabled, func, user_data);
+}
+
+/* applies the difference between the currently enabled sensors and
+ * enabled_sensors as a single bulk update - sensor-enabled and
+ * sensor-disabled are still emitted for each sensor which changes but
+ * positions-changed is emitted only once at the end instead of
+ * sensor-position-changed for every sensor which moved */
 gboolean
 is_manager_set_enabled_sensors(IsManager *self,
                                const gchar **enabled_sensors)
 {
   IsManagerPrivate *priv;
   int i, n;
-  GSList *list;
+  GSequenceIter *seq_iter, *next;
   GTree *tree;
 
   g_return_val_if_fail(IS_IS_MANAGER(self), FALSE);
@@ -546,45 +657,60 @@ is_manager_set_enabled_sensors(IsManager *self,
   tree = g_tree_new_full((GCompareDataFunc)g_strcmp0, NULL, g_free, NULL);
 
   /* copy this list as new tree of enabled sensors */
-  n = g_strv_length((gchar **)enabled_sensors);
-
-  /* copy list and also enable all sensors in the list */
+  n = enabled_sensors ? g_strv_length((gchar **)enabled_sensors) : 0;
   for (i = 0; i < n; i++)
   {
-    gchar *path;
-    GtkTreeIter iter;
-
-    path = g_strdup(enabled_sensors[i]);
+    gchar *path = g_strdup(enabled_sensors[i]);
     g_tree_insert(tree, path, path);
-
-    if (is_store_get_iter(priv->store, path, &iter))
-    {
-      IsSensor *sensor;
-
-      gtk_tree_model_get(GTK_TREE_MODEL(priv->store), &iter,
-                         IS_STORE_COL_SENSOR, &sensor,
-                         -1);
-      enable_sensor(self, &iter, sensor);
-    }
   }
 
-  for (list = priv->enabled_list; list != NULL; list = list->next)
+  begin_bulk_update(self);
+
+  /* disable those which are no longer in the list first so the sensors
+   * which are enabled get inserted into a shorter sequence - get next
+   * before disabling the current sensor since that removes it from the
+   * sequence */
+  for (seq_iter = g_sequence_get_begin_iter(priv->enabled);
+       !g_sequence_iter_is_end(seq_iter);
+       seq_iter = next)
   {
-    IsSensor *sensor = (IsSensor *)list->data;
+    IsSensor *sensor = (IsSensor *)g_sequence_get(seq_iter);
     const gchar *path;
 
+    next = g_sequence_iter_next(seq_iter);
     path = is_sensor_get_path(sensor);
     if (!g_tree_lookup(tree, path))
     {
       GtkTreeIter iter;
       is_store_get_iter(priv->store, path, &iter);
-      disable_sensor(self, &iter, sensor);
+      _disable_sensor(self, &iter, sensor);
+    }
+  }
+
+  /* then enable any newly listed sensors which exist */
+  for (i = 0; i < n; i++)
+  {
+    GtkTreeIter iter;
+
+    if (is_store_get_iter(priv->store, enabled_sensors[i], &iter))
+    {
+      IsSensor *sensor;
+
+      gtk_tree_model_get(GTK_TREE_MODEL(priv->store), &iter,
+                         IS_STORE_COL_SENSOR, &sensor,
+                         -1);
+      if (!g_hash_table_lookup(priv->enabled_iters, sensor))
+      {
+        enable_sensor(self, &iter, sensor);
+      }
+      g_object_unref(sensor);
     }
   }
   g_tree_destroy(priv->enabled_paths);
   priv->enabled_paths = tree;
-  g_object_notify_by_pspec(G_OBJECT(self),
-                           properties[PROP_ENABLED_SENSORS]);
+  priv->enabled_sensors_changed = TRUE;
+
+  end_bulk_update(self);
   return TRUE;
 }
 
@@ -596,7 +722,7 @@ guint is_manager_get_num_enabled_sensors(IsManager *self)
 
   priv = self->priv;
 
-  return g_slist_length(priv->enabled_list);
+  return g_sequence_get_length(priv->enabled);
 }
 
 static gboolean
@@ -72,6 +72,9 @@ IsSensor *is_manager_get_sensor(IsManager *self,
                                 const gchar *path);
 GSList *is_manager_get_all_sensors_list(IsManager *self);
 GSList *is_manager_get_enabled_sensors_list(IsManager *self);
+void is_manager_foreach_enabled_sensor(IsManager *self,
+                                       GFunc func,
+                                       gpointer user_data);
 guint is_manager_get_num_enabled_sensors(IsManager *self);
 gchar **is_manager_get_enabled_sensors(IsManager *self);
 gboolean is_manager_set_enabled_sensors(IsManager *self,
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2011-2019 Alex Murray <murray.alex@gmail.com>
+ *
+ * indicator-sensors is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * indicator-sensors is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with indicator-sensors.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "is-power-sensor.h"
+#include <glib/gi18n.h>
+
+G_DEFINE_TYPE(IsPowerSensor, is_power_sensor, IS_TYPE_SENSOR);
+
+static void
+is_power_sensor_class_init(IsPowerSensorClass *klass)
+{
+  /* nothing to do */
+}
+
+static void
+is_power_sensor_init(IsPowerSensor *self)
+{
+  /* nothing to do */
+}
+
+IsSensor *
+is_power_sensor_new(const gchar *path)
+{
+  return g_object_new(IS_TYPE_POWER_SENSOR,
+                      "path", path,
+                      "value", IS_SENSOR_VALUE_UNSET,
+                      /* translators: W is the unit for power in watts */
+                      "units", _(" W"),
+                      "digits", 1,
+                      "low-value", 0.0,
+                      "high-value", 200.0,
+                      "icon", IS_STOCK_CHIP,
+                      NULL);
+}
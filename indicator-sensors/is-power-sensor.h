@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2011-2019 Alex Murray <murray.alex@gmail.com>
+ *
+ * indicator-sensors is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * indicator-sensors is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with indicator-sensors.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __IS_POWER_SENSOR_H__
+#define __IS_POWER_SENSOR_H__
+
+#include "is-sensor.h"
+
+
+G_BEGIN_DECLS
+
+#define IS_TYPE_POWER_SENSOR    \
+  (is_power_sensor_get_type())
+#define IS_POWER_SENSOR(obj)        \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),      \
+                              IS_TYPE_POWER_SENSOR, \
+                              IsPowerSensor))
+#define IS_POWER_SENSOR_CLASS(klass)      \
+  (G_TYPE_CHECK_CLASS_CAST((klass),     \
+                           IS_TYPE_POWER_SENSOR,  \
+                           IsPowerSensorClass))
+#define IS_IS_POWER_SENSOR(obj)                                   \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),        \
+                              IS_TYPE_POWER_SENSOR))
+#define IS_IS_POWER_SENSOR_CLASS(klass)     \
+  (G_TYPE_CHECK_CLASS_TYPE((klass),     \
+                           IS_TYPE_POWER_SENSOR))
+#define IS_POWER_SENSOR_GET_CLASS(obj)      \
+  (G_TYPE_INSTANCE_GET_CLASS((obj),     \
+                             IS_TYPE_POWER_SENSOR,  \
+                             IsPowerSensorClass))
+
+typedef struct _IsPowerSensor      IsPowerSensor;
+typedef struct _IsPowerSensorClass IsPowerSensorClass;
+
+struct _IsPowerSensorClass
+{
+  IsSensorClass parent_class;
+};
+
+struct _IsPowerSensor
+{
+  IsSensor parent;
+};
+
+GType is_power_sensor_get_type(void) G_GNUC_CONST;
+IsSensor *is_power_sensor_new(const gchar *path);
+
+G_END_DECLS
+
+#endif /* __IS_POWER_SENSOR_H__ */
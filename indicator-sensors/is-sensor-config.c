@@ -0,0 +1,556 @@
+/*
+ * Copyright (C) 2011-2019 Alex Murray <murray.alex@gmail.com>
+ *
+ * indicator-sensors is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * indicator-sensors is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with indicator-sensors.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Sensor config is kept in a GKeyFile but rather than rewriting the whole
+ * file every time a value changes, changes are batched up over the write
+ * delay and then only those values which differ from what is already on
+ * disk are appended as records to a journal alongside the file. Once the
+ * journal gets long enough (or on exit) it is compacted by atomically
+ * rewriting the key file and removing the journal. On load the journal is
+ * replayed over the key file so a crash never loses more than the current
+ * batch.
+ */
+
+#include "is-sensor-config.h"
+#include "is-log.h"
+#include <glib/gstdio.h>
+#include <errno.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#define JOURNAL_SUFFIX ".journal"
+/* number of journal records after which we compact */
+#define COMPACT_THRESHOLD 64
+
+struct _IsSensorConfig
+{
+  gchar *path;
+  gchar *journal_path;
+  /* current values */
+  GKeyFile *key_file;
+  /* values as they are on disk - ie. key file plus journal */
+  GKeyFile *written;
+  /* keys which have been set since the last write */
+  GHashTable *pending;
+  guint n_records;
+  guint write_delay;
+  guint write_id;
+};
+
+typedef struct
+{
+  gchar *group;
+  gchar *key;
+} ConfigKey;
+
+static guint
+config_key_hash(const ConfigKey *config_key)
+{
+  return (g_str_hash(config_key->group) * 31) + g_str_hash(config_key->key);
+}
+
+static gboolean
+config_key_equal(const ConfigKey *a,
+                 const ConfigKey *b)
+{
+  return (g_strcmp0(a->group, b->group) == 0 &&
+          g_strcmp0(a->key, b->key) == 0);
+}
+
+static void
+config_key_free(ConfigKey *config_key)
+{
+  g_free(config_key->group);
+  g_free(config_key->key);
+  g_slice_free(ConfigKey, config_key);
+}
+
+static guint
+replay_journal(IsSensorConfig *self)
+{
+  gchar *data = NULL, *end;
+  gchar **lines;
+  guint i, n, n_records = 0;
+  gsize len;
+  GError *error = NULL;
+
+  if (!g_file_get_contents(self->journal_path, &data, &len, &error))
+  {
+    if (!g_error_matches(error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+    {
+      is_warning("sensor-config", "Failed to read sensor config journal %s: %s",
+                 self->journal_path, error->message);
+    }
+    g_error_free(error);
+    goto out;
+  }
+
+  lines = g_strsplit(data, "\n", -1);
+  n = g_strv_length(lines);
+  /* the last line is either empty or was only partially written so ignore
+   * it */
+  for (i = 0; i + 1 < n; i++)
+  {
+    gchar **fields = g_strsplit(lines[i], "\t", 3);
+
+    if (g_strv_length(fields) == 3)
+    {
+      gchar *group = g_strcompress(fields[0]);
+      gchar *key = g_strcompress(fields[1]);
+      gchar *value = g_strcompress(fields[2]);
+
+      g_key_file_set_value(self->key_file, group, key, value);
+      g_key_file_set_value(self->written, group, key, value);
+      n_records++;
+
+      g_free(value);
+      g_free(key);
+      g_free(group);
+    }
+    else
+    {
+      is_warning("sensor-config", "Ignoring invalid record in sensor config journal %s: %s",
+                 self->journal_path, lines[i]);
+    }
+    g_strfreev(fields);
+  }
+  g_strfreev(lines);
+
+  /* drop any partially written last record otherwise the next one would
+   * be appended to it */
+  if (len > 0 && data[len - 1] != '\n')
+  {
+    end = g_strrstr_len(data, len, "\n");
+    is_warning("sensor-config", "Discarding partial record at end of sensor config journal %s",
+               self->journal_path);
+    if (truncate(self->journal_path, end ? (end - data) + 1 : 0) < 0)
+    {
+      is_warning("sensor-config", "Failed to truncate sensor config journal %s: %s",
+                 self->journal_path, g_strerror(errno));
+    }
+  }
+  g_free(data);
+
+out:
+  return n_records;
+}
+
+static gboolean
+ensure_directory(IsSensorConfig *self)
+{
+  gchar *dir;
+  gboolean ret;
+
+  dir = g_path_get_dirname(self->path);
+  ret = (g_mkdir_with_parents(dir, 0755) == 0);
+  if (!ret)
+  {
+    is_warning("sensor-config", "Failed to create directory %s", dir);
+  }
+  g_free(dir);
+  return ret;
+}
+
+/* rewrite the whole key file from what has been written and drop the now
+ * redundant journal */
+static gboolean
+compact(IsSensorConfig *self)
+{
+  gchar *data;
+  gsize len;
+  GError *error = NULL;
+  gboolean ret;
+
+  ensure_directory(self);
+  data = g_key_file_to_data(self->written, &len, NULL);
+  ret = g_file_set_contents(self->path, data, len, &error);
+  g_free(data);
+  if (!ret)
+  {
+    is_warning("sensor-config", "Failed to write sensor config to file %s: %s",
+               self->path, error->message);
+    g_error_free(error);
+    goto out;
+  }
+  if (g_unlink(self->journal_path) < 0 && errno != ENOENT)
+  {
+    is_warning("sensor-config", "Failed to remove sensor config journal %s: %s",
+               self->journal_path, g_strerror(errno));
+  }
+  self->n_records = 0;
+
+out:
+  return ret;
+}
+
+static gboolean
+append_journal(IsSensorConfig *self,
+               const gchar *records)
+{
+  FILE *file;
+  gboolean ret = FALSE;
+
+  ensure_directory(self);
+  file = fopen(self->journal_path, "a");
+  if (!file)
+  {
+    goto error;
+  }
+  if (fputs(records, file) == EOF ||
+      fflush(file) != 0 ||
+      fsync(fileno(file)) != 0)
+  {
+    fclose(file);
+    goto error;
+  }
+  ret = (fclose(file) == 0);
+  if (ret)
+  {
+    goto out;
+  }
+
+error:
+  is_warning("sensor-config", "Failed to append to sensor config journal %s: %s",
+             self->journal_path, g_strerror(errno));
+out:
+  return ret;
+}
+
+static void
+append_record(GString *records,
+              const gchar *group,
+              const gchar *key,
+              const gchar *value)
+{
+  gchar *escaped;
+
+  escaped = g_strescape(group, NULL);
+  g_string_append(records, escaped);
+  g_string_append_c(records, '\t');
+  g_free(escaped);
+  escaped = g_strescape(key, NULL);
+  g_string_append(records, escaped);
+  g_string_append_c(records, '\t');
+  g_free(escaped);
+  escaped = g_strescape(value, NULL);
+  g_string_append(records, escaped);
+  g_string_append_c(records, '\n');
+  g_free(escaped);
+}
+
+static void
+write_pending(IsSensorConfig *self)
+{
+  GHashTableIter iter;
+  ConfigKey *config_key;
+  GString *records;
+  /* values as they were on disk before this write for each key written
+   * so they can be restored if it fails */
+  GHashTable *previous;
+  guint n = 0;
+  gboolean ret;
+
+  records = g_string_new(NULL);
+  previous = g_hash_table_new_full((GHashFunc)config_key_hash,
+                                   (GEqualFunc)config_key_equal,
+                                   (GDestroyNotify)config_key_free,
+                                   g_free);
+  g_hash_table_iter_init(&iter, self->pending);
+  while (g_hash_table_iter_next(&iter, (gpointer *)&config_key, NULL))
+  {
+    gchar *value, *written;
+
+    value = g_key_file_get_value(self->key_file, config_key->group,
+                                 config_key->key, NULL);
+    written = g_key_file_get_value(self->written, config_key->group,
+                                   config_key->key, NULL);
+    /* skip any which have been set back to what is already on disk */
+    if (value && g_strcmp0(value, written) != 0)
+    {
+      append_record(records, config_key->group, config_key->key, value);
+      /* compact() writes out whatever is in written */
+      g_key_file_set_value(self->written, config_key->group,
+                           config_key->key, value);
+      g_hash_table_iter_steal(&iter);
+      g_hash_table_insert(previous, config_key, written);
+      written = NULL;
+      n++;
+    }
+    g_free(written);
+    g_free(value);
+  }
+  g_hash_table_remove_all(self->pending);
+
+  if (n == 0)
+  {
+    goto out;
+  }
+  is_debug("sensor-config", "Writing %u changed sensor config values", n);
+  if (self->n_records + n < COMPACT_THRESHOLD &&
+      append_journal(self, records->str))
+  {
+    self->n_records += n;
+    ret = TRUE;
+  }
+  else
+  {
+    ret = compact(self);
+  }
+  if (!ret)
+  {
+    /* not on disk after all so put them back to be tried again with the
+     * next write */
+    gchar *written;
+
+    g_hash_table_iter_init(&iter, previous);
+    while (g_hash_table_iter_next(&iter, (gpointer *)&config_key,
+                                  (gpointer *)&written))
+    {
+      if (written)
+      {
+        g_key_file_set_value(self->written, config_key->group,
+                             config_key->key, written);
+      }
+      else
+      {
+        g_key_file_remove_key(self->written, config_key->group,
+                              config_key->key, NULL);
+      }
+      g_hash_table_iter_steal(&iter);
+      g_free(written);
+      g_hash_table_add(self->pending, config_key);
+    }
+  }
+
+out:
+  g_hash_table_destroy(previous);
+  g_string_free(records, TRUE);
+}
+
+static gboolean
+write_timeout(IsSensorConfig *self)
+{
+  self->write_id = 0;
+  write_pending(self);
+  return FALSE;
+}
+
+static void
+value_set(IsSensorConfig *self,
+          const gchar *group,
+          const gchar *key)
+{
+  ConfigKey lookup, *config_key;
+
+  lookup.group = (gchar *)group;
+  lookup.key = (gchar *)key;
+  if (!g_hash_table_contains(self->pending, &lookup))
+  {
+    gchar *value, *written;
+    gboolean changed;
+
+    /* nothing to do if this is already on disk */
+    value = g_key_file_get_value(self->key_file, group, key, NULL);
+    written = g_key_file_get_value(self->written, group, key, NULL);
+    changed = (g_strcmp0(value, written) != 0);
+    g_free(written);
+    g_free(value);
+    if (!changed)
+    {
+      return;
+    }
+    config_key = g_slice_new(ConfigKey);
+    config_key->group = g_strdup(group);
+    config_key->key = g_strdup(key);
+    g_hash_table_add(self->pending, config_key);
+  }
+  /* don't restart the timeout on each change so a continuous stream of
+   * changes still gets written every write_delay */
+  if (!self->write_id)
+  {
+    self->write_id = g_timeout_add(self->write_delay,
+                                   (GSourceFunc)write_timeout, self);
+  }
+}
+
+IsSensorConfig *
+is_sensor_config_new(const gchar *path)
+{
+  IsSensorConfig *self;
+  GError *error = NULL;
+
+  g_return_val_if_fail(path != NULL, NULL);
+
+  self = g_slice_new0(IsSensorConfig);
+  self->path = g_strdup(path);
+  self->journal_path = g_strconcat(path, JOURNAL_SUFFIX, NULL);
+  self->key_file = g_key_file_new();
+  self->written = g_key_file_new();
+  self->pending = g_hash_table_new_full((GHashFunc)config_key_hash,
+                                        (GEqualFunc)config_key_equal,
+                                        (GDestroyNotify)config_key_free,
+                                        NULL);
+  self->write_delay = IS_SENSOR_CONFIG_DEFAULT_WRITE_DELAY;
+
+  if (!g_key_file_load_from_file(self->key_file,
+                                 path,
+                                 G_KEY_FILE_KEEP_COMMENTS | G_KEY_FILE_KEEP_TRANSLATIONS,
+                                 &error))
+  {
+    is_warning("sensor-config", "Failed to load sensor configs from file %s: %s",
+               path, error->message);
+    g_clear_error(&error);
+  }
+  else
+  {
+    g_key_file_load_from_file(self->written,
+                              path,
+                              G_KEY_FILE_KEEP_COMMENTS | G_KEY_FILE_KEEP_TRANSLATIONS,
+                              NULL);
+  }
+  self->n_records = replay_journal(self);
+  return self;
+}
+
+void
+is_sensor_config_flush(IsSensorConfig *self)
+{
+  g_return_if_fail(self != NULL);
+
+  if (self->write_id)
+  {
+    g_source_remove(self->write_id);
+    self->write_id = 0;
+  }
+  write_pending(self);
+}
+
+/* writes everything out and compacts the journal into the key file -
+ * call before exiting */
+void
+is_sensor_config_sync(IsSensorConfig *self)
+{
+  g_return_if_fail(self != NULL);
+
+  is_sensor_config_flush(self);
+  if (self->n_records > 0)
+  {
+    compact(self);
+  }
+}
+
+void
+is_sensor_config_free(IsSensorConfig *self)
+{
+  g_return_if_fail(self != NULL);
+
+  is_sensor_config_sync(self);
+  g_hash_table_destroy(self->pending);
+  g_key_file_free(self->written);
+  g_key_file_free(self->key_file);
+  g_free(self->journal_path);
+  g_free(self->path);
+  g_slice_free(IsSensorConfig, self);
+}
+
+guint
+is_sensor_config_get_write_delay(IsSensorConfig *self)
+{
+  g_return_val_if_fail(self != NULL, 0);
+
+  return self->write_delay;
+}
+
+void
+is_sensor_config_set_write_delay(IsSensorConfig *self,
+                                 guint write_delay)
+{
+  g_return_if_fail(self != NULL);
+
+  /* takes effect from the next batch */
+  self->write_delay = write_delay;
+}
+
+gchar *
+is_sensor_config_get_string(IsSensorConfig *self,
+                            const gchar *group,
+                            const gchar *key,
+                            GError **error)
+{
+  g_return_val_if_fail(self != NULL, NULL);
+
+  return g_key_file_get_string(self->key_file, group, key, error);
+}
+
+void
+is_sensor_config_set_string(IsSensorConfig *self,
+                            const gchar *group,
+                            const gchar *key,
+                            const gchar *value)
+{
+  g_return_if_fail(self != NULL);
+
+  g_key_file_set_string(self->key_file, group, key, value);
+  value_set(self, group, key);
+}
+
+gdouble
+is_sensor_config_get_double(IsSensorConfig *self,
+                            const gchar *group,
+                            const gchar *key,
+                            GError **error)
+{
+  g_return_val_if_fail(self != NULL, 0.0);
+
+  return g_key_file_get_double(self->key_file, group, key, error);
+}
+
+void
+is_sensor_config_set_double(IsSensorConfig *self,
+                            const gchar *group,
+                            const gchar *key,
+                            gdouble value)
+{
+  g_return_if_fail(self != NULL);
+
+  g_key_file_set_double(self->key_file, group, key, value);
+  value_set(self, group, key);
+}
+
+gint64
+is_sensor_config_get_int64(IsSensorConfig *self,
+                           const gchar *group,
+                           const gchar *key,
+                           GError **error)
+{
+  g_return_val_if_fail(self != NULL, 0);
+
+  return g_key_file_get_int64(self->key_file, group, key, error);
+}
+
+void
+is_sensor_config_set_int64(IsSensorConfig *self,
+                           const gchar *group,
+                           const gchar *key,
+                           gint64 value)
+{
+  g_return_if_fail(self != NULL);
+
+  g_key_file_set_int64(self->key_file, group, key, value);
+  value_set(self, group, key);
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2011-2019 Alex Murray <murray.alex@gmail.com>
+ *
+ * indicator-sensors is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * indicator-sensors is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with indicator-sensors.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __IS_SENSOR_CONFIG_H__
+#define __IS_SENSOR_CONFIG_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* default time in milliseconds to batch up changes before writing them */
+#define IS_SENSOR_CONFIG_DEFAULT_WRITE_DELAY 2000
+
+typedef struct _IsSensorConfig IsSensorConfig;
+
+IsSensorConfig *is_sensor_config_new(const gchar *path);
+void is_sensor_config_free(IsSensorConfig *self);
+guint is_sensor_config_get_write_delay(IsSensorConfig *self);
+void is_sensor_config_set_write_delay(IsSensorConfig *self,
+                                      guint write_delay);
+gchar *is_sensor_config_get_string(IsSensorConfig *self,
+                                   const gchar *group,
+                                   const gchar *key,
+                                   GError **error);
+void is_sensor_config_set_string(IsSensorConfig *self,
+                                 const gchar *group,
+                                 const gchar *key,
+                                 const gchar *value);
+gdouble is_sensor_config_get_double(IsSensorConfig *self,
+                                    const gchar *group,
+                                    const gchar *key,
+                                    GError **error);
+void is_sensor_config_set_double(IsSensorConfig *self,
+                                 const gchar *group,
+                                 const gchar *key,
+                                 gdouble value);
+gint64 is_sensor_config_get_int64(IsSensorConfig *self,
+                                  const gchar *group,
+                                  const gchar *key,
+                                  GError **error);
+void is_sensor_config_set_int64(IsSensorConfig *self,
+                                const gchar *group,
+                                const gchar *key,
+                                gint64 value);
+void is_sensor_config_flush(IsSensorConfig *self);
+void is_sensor_config_sync(IsSensorConfig *self);
+
+G_END_DECLS
+
+#endif /* __IS_SENSOR_CONFIG_H__ */
@@ -384,6 +384,10 @@ is_sensor_dialog_set_property(GObject *object,
                        self);
       gtk_label_set_text(GTK_LABEL(priv->high_units_label),
                          is_sensor_get_units(priv->sensor));
+
+      /* some plugins only fetch limits like the low and high values on
+       * demand */
+      is_sensor_request_limits(priv->sensor);
       break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
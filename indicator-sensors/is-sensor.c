@@ -44,6 +44,8 @@ static void is_sensor_set_property(GObject *object,
 enum
 {
   SIGNAL_UPDATE_VALUE,
+  SIGNAL_CHANGED,
+  SIGNAL_REQUEST_LIMITS,
   LAST_SIGNAL
 };
 
@@ -72,6 +74,24 @@ enum
 
 static GParamSpec *properties[LAST_PROPERTY] = {NULL};
 
+/* which bit of the changed signal corresponds to each property */
+static const guint changed_flags[LAST_PROPERTY] =
+{
+  [PROP_LABEL] = IS_SENSOR_CHANGED_LABEL,
+  [PROP_VALUE] = IS_SENSOR_CHANGED_VALUE,
+  [PROP_DIGITS] = IS_SENSOR_CHANGED_DIGITS,
+  [PROP_ALARM_VALUE] = IS_SENSOR_CHANGED_ALARM_VALUE,
+  [PROP_ALARM_MODE] = IS_SENSOR_CHANGED_ALARM_MODE,
+  [PROP_UNITS] = IS_SENSOR_CHANGED_UNITS,
+  [PROP_UPDATE_INTERVAL] = IS_SENSOR_CHANGED_UPDATE_INTERVAL,
+  [PROP_ALARMED] = IS_SENSOR_CHANGED_ALARMED,
+  [PROP_ICON] = IS_SENSOR_CHANGED_ICON,
+  [PROP_LOW_VALUE] = IS_SENSOR_CHANGED_LOW_VALUE,
+  [PROP_HIGH_VALUE] = IS_SENSOR_CHANGED_HIGH_VALUE,
+  [PROP_ICON_PATH] = IS_SENSOR_CHANGED_ICON_PATH,
+  [PROP_ERROR] = IS_SENSOR_CHANGED_ERROR,
+};
+
 struct _IsSensorPrivate
 {
   gchar *path;
@@ -84,13 +104,16 @@ struct _IsSensorPrivate
   guint update_interval;
   gint64 last_update;
   gboolean alarmed;
-  gchar *icon;
+  const gchar *icon;
   gdouble low_value;
   gdouble high_value;
   guint enable_alarm_id;
   guint disable_alarm_id;
-  gchar *icon_path;
+  const gchar *icon_path;
   gchar *error;
+  guint changed;
+  guint changed_freeze_count;
+  guint config_freeze_count;
 };
 
 static void
@@ -193,8 +216,34 @@ is_sensor_class_init(IsSensorClass *klass)
                                  NULL, NULL,
                                  g_cclosure_marshal_VOID__VOID,
                                  G_TYPE_NONE, 0);
+
+  /* emitted once with all the IsSensorChangedFlags for properties which
+   * changed since the last emission - ie. if frozen via
+   * is_sensor_freeze_changed() all changes are coalesced until thawed */
+  signals[SIGNAL_CHANGED] = g_signal_new("changed",
+                                         G_OBJECT_CLASS_TYPE(klass),
+                                         G_SIGNAL_RUN_LAST,
+                                         offsetof(IsSensorClass, changed),
+                                         NULL, NULL,
+                                         g_cclosure_marshal_VOID__UINT,
+                                         G_TYPE_NONE, 1,
+                                         G_TYPE_UINT);
+
+  /* emitted when the limits of the sensor are wanted (ie. its dialog is
+   * opened) for plugins which only read them on demand */
+  signals[SIGNAL_REQUEST_LIMITS] = g_signal_new("request-limits",
+                                  G_OBJECT_CLASS_TYPE(klass),
+                                  G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+                                  offsetof(IsSensorClass, request_limits),
+                                  NULL, NULL,
+                                  g_cclosure_marshal_VOID__VOID,
+                                  G_TYPE_NONE, 0);
 }
 
+/* every sensor in existence so their icon paths can be updated as the
+ * icon cache is filled */
+static GList *live_sensors = NULL;
+
 static void
 is_sensor_init(IsSensor *self)
 {
@@ -203,6 +252,31 @@ is_sensor_init(IsSensor *self)
                                 IsSensorPrivate);
 
   self->priv = priv;
+  live_sensors = g_list_prepend(live_sensors, self);
+}
+
+static void
+emit_changed(IsSensor *self)
+{
+  guint changed = self->priv->changed;
+
+  if (changed)
+  {
+    self->priv->changed = 0;
+    g_signal_emit(self, signals[SIGNAL_CHANGED], 0, changed);
+  }
+}
+
+static void
+sensor_notify(IsSensor *self,
+              guint property_id)
+{
+  g_object_notify_by_pspec(G_OBJECT(self), properties[property_id]);
+  self->priv->changed |= changed_flags[property_id];
+  if (!self->priv->changed_freeze_count)
+  {
+    emit_changed(self);
+  }
 }
 
 static void
@@ -313,6 +387,7 @@ is_sensor_finalize (GObject *object)
   IsSensor *self = (IsSensor *)object;
   IsSensorPrivate *priv = self->priv;
 
+  live_sensors = g_list_remove(live_sensors, self);
   g_free(priv->path);
   priv->path = NULL;
   g_free(priv->label);
@@ -369,8 +444,7 @@ is_sensor_set_label(IsSensor *self,
   {
     g_free(priv->label);
     priv->label = label ? g_strdup(label) : NULL;
-    g_object_notify_by_pspec(G_OBJECT(self),
-                             properties[PROP_LABEL]);
+    sensor_notify(self, PROP_LABEL);
   }
 }
 
@@ -387,8 +461,7 @@ enable_alarm(IsSensor *self)
   g_return_val_if_fail(self != NULL, FALSE);
 
   self->priv->alarmed = TRUE;
-  g_object_notify_by_pspec(G_OBJECT(self),
-                           properties[PROP_ALARMED]);
+  sensor_notify(self, PROP_ALARMED);
   self->priv->enable_alarm_id = 0;
   /* remove as source */
   return FALSE;
@@ -400,8 +473,7 @@ disable_alarm(IsSensor *self)
   g_return_val_if_fail(self != NULL, FALSE);
 
   self->priv->alarmed = FALSE;
-  g_object_notify_by_pspec(G_OBJECT(self),
-                           properties[PROP_ALARMED]);
+  sensor_notify(self, PROP_ALARMED);
   self->priv->disable_alarm_id = 0;
   return FALSE;
 }
@@ -452,12 +524,198 @@ static const gchar * const value_overlay_icons[NUM_OVERLAY_ICONS] =
   "very-high-value-icon"
 };
 
-static const gchar *value_overlay_icon(gdouble value,
-                                       gdouble low,
-                                       gdouble high)
+/* process-wide cache of composited icon paths for each stock icon and value
+ * range - all strings are interned so once an entry is prepared looking it
+ * up again is just a table lookup */
+#define NUM_STOCK_ICONS 8
+
+static const gchar * const stock_icons[NUM_STOCK_ICONS] =
+{
+  IS_STOCK_CPU,
+  IS_STOCK_DISK,
+  IS_STOCK_BATTERY,
+  IS_STOCK_MEMORY,
+  IS_STOCK_GPU,
+  IS_STOCK_CHIP,
+  IS_STOCK_FAN,
+  IS_STOCK_CASE,
+};
+
+typedef struct
+{
+  const gchar *base_name;
+  const gchar *icon_paths[NUM_OVERLAY_ICONS];
+} IconCacheEntry;
+
+static IconCacheEntry icon_cache[NUM_STOCK_ICONS];
+
+static IconCacheEntry *
+icon_cache_lookup(const gchar *base_name)
+{
+  static gboolean initialised = FALSE;
+  guint i;
+
+  if (!initialised)
+  {
+    for (i = 0; i < NUM_STOCK_ICONS; i++)
+    {
+      icon_cache[i].base_name = g_intern_static_string(stock_icons[i]);
+    }
+    initialised = TRUE;
+  }
+
+  /* base_name is interned so can just compare pointers */
+  for (i = 0; i < NUM_STOCK_ICONS; i++)
+  {
+    if (icon_cache[i].base_name == base_name)
+    {
+      return &icon_cache[i];
+    }
+  }
+  return NULL;
+}
+
+/* icons are cached in a directory per icon theme so that cached icons only
+ * need to be regenerated when the icon theme changes */
+static gchar *icon_cache_dir = NULL;
+/* incremented whenever the cache is reset so any stale in-flight warm-up
+ * results can be ignored */
+static guint icon_cache_generation = 0;
+
+static void
+icon_cache_remove_stale(const gchar *icons_dir,
+                        const gchar *theme)
+{
+  GDir *dir, *subdir;
+  const gchar *name, *filename;
+
+  dir = g_dir_open(icons_dir, 0, NULL);
+  if (!dir)
+  {
+    goto out;
+  }
+
+  for (name = g_dir_read_name(dir);
+       name != NULL;
+       name = g_dir_read_name(dir))
+  {
+    gchar *path;
+
+    if (g_strcmp0(name, theme) == 0)
+    {
+      continue;
+    }
+    path = g_build_filename(icons_dir, name, NULL);
+    is_debug("sensor", "Removing stale icon cache %s", path);
+    subdir = g_dir_open(path, 0, NULL);
+    if (subdir)
+    {
+      for (filename = g_dir_read_name(subdir);
+           filename != NULL;
+           filename = g_dir_read_name(subdir))
+      {
+        gchar *file = g_build_filename(path, filename, NULL);
+        g_remove(file);
+        g_free(file);
+      }
+      g_dir_close(subdir);
+      g_rmdir(path);
+    }
+    else
+    {
+      /* icons from before we cached per theme */
+      g_remove(path);
+    }
+    g_free(path);
+  }
+  g_dir_close(dir);
+
+out:
+  return;
+}
+
+static void
+icon_cache_reset(void)
+{
+  gchar *theme = NULL, *icons_dir;
+  guint i, j;
+
+  icon_cache_generation++;
+  for (i = 0; i < NUM_STOCK_ICONS; i++)
+  {
+    for (j = 0; j < NUM_OVERLAY_ICONS; j++)
+    {
+      icon_cache[i].icon_paths[j] = NULL;
+    }
+  }
+
+  g_object_get(gtk_settings_get_default(),
+               "gtk-icon-theme-name", &theme,
+               NULL);
+  if (!theme)
+  {
+    theme = g_strdup("default");
+  }
+  g_strdelimit(theme, G_DIR_SEPARATOR_S, '_');
+
+  icons_dir = g_build_filename(g_get_user_cache_dir(),
+                               PACKAGE, "icons", NULL);
+  icon_cache_remove_stale(icons_dir, theme);
+  g_free(icon_cache_dir);
+  icon_cache_dir = g_build_filename(icons_dir, theme, NULL);
+  g_mkdir_with_parents(icon_cache_dir, 0755);
+  is_debug("sensor", "Using icon cache %s", icon_cache_dir);
+  g_free(icons_dir);
+  g_free(theme);
+}
+
+static gchar *
+cache_icon_path(const gchar *base_icon_name,
+                const gchar *overlay_name)
+{
+  gchar *icon_name, *icon_path;
+
+  if (!icon_cache_dir)
+  {
+    icon_cache_reset();
+  }
+  icon_name = g_strdup_printf("%s-%s.png", base_icon_name, overlay_name);
+  icon_path = g_build_filename(icon_cache_dir, icon_name, NULL);
+  g_free(icon_name);
+  return icon_path;
+}
+
+/* composite overlay onto base and save to icon_path - this is safe to call
+ * from any thread and writes atomically so a concurrent reader never sees
+ * a partial icon */
+static gboolean
+composite_cache_icon(GdkPixbuf *base_icon,
+                     GdkPixbuf *overlay_icon,
+                     const gchar *icon_path,
+                     GError **error)
 {
-  SensorValueRange value_range = sensor_value_range(value, low, high);
-  return value_overlay_icons[value_range];
+  GdkPixbuf *new_icon;
+  gchar *buffer = NULL;
+  gsize len;
+  gboolean ret;
+
+  new_icon = gdk_pixbuf_copy(base_icon);
+  gdk_pixbuf_composite(overlay_icon, new_icon,
+                       0, 0,
+                       DEFAULT_ICON_SIZE, DEFAULT_ICON_SIZE,
+                       0, 0,
+                       1.0, 1.0,
+                       GDK_INTERP_BILINEAR,
+                       255);
+
+  ret = gdk_pixbuf_save_to_buffer(new_icon, &buffer, &len, "png", error, NULL);
+  if (ret)
+  {
+    ret = g_file_set_contents(icon_path, buffer, len, error);
+  }
+  g_free(buffer);
+  g_object_unref(new_icon);
+  return ret;
 }
 
 static gboolean
@@ -466,7 +724,7 @@ prepare_cache_icon(const gchar *base_icon_name,
                    const gchar *icon_path,
                    GError **error)
 {
-  GdkPixbuf *base_icon, *overlay_icon, *new_icon;
+  GdkPixbuf *base_icon, *overlay_icon;
   gchar *icon_dir;
   GtkIconTheme *icon_theme;
   gboolean ret;
@@ -500,43 +758,35 @@ prepare_cache_icon(const gchar *base_icon_name,
     goto out;
   }
 
-  new_icon = gdk_pixbuf_copy(base_icon);
-  gdk_pixbuf_composite(overlay_icon, new_icon,
-                       0, 0,
-                       DEFAULT_ICON_SIZE, DEFAULT_ICON_SIZE,
-                       0, 0,
-                       1.0, 1.0,
-                       GDK_INTERP_BILINEAR,
-                       255);
-  g_object_unref(overlay_icon);
-
   /* ensure path to icon exists */
   icon_dir = g_path_get_dirname(icon_path);
   g_mkdir_with_parents(icon_dir, 0755);
   g_free(icon_dir);
 
   /* write out icon */
-  ret = gdk_pixbuf_save(new_icon, icon_path, "png", error, NULL);
-  g_object_unref(new_icon);
+  ret = composite_cache_icon(base_icon, overlay_icon, icon_path, error);
+  g_object_unref(overlay_icon);
   g_object_unref(base_icon);
 
 out:
   return ret;
 }
 
-static gchar *
+static const gchar *
 get_icon_path(IsSensor *self)
 {
-  gdouble value, low, high;
+  gdouble low, high;
   const gchar *base_name, *overlay_name;
-  gchar *icon_name, *icon_path = NULL, *cache_dir;
+  const gchar *icon_path = NULL;
+  IconCacheEntry *entry;
+  SensorValueRange range;
+  gchar *path;
   gboolean ret;
   GError *error = NULL;
 
-  base_name = is_sensor_get_icon(self);
-  value = is_sensor_get_value(self);
-  low = is_sensor_get_low_value(self);
-  high = is_sensor_get_high_value(self);
+  base_name = self->priv->icon;
+  low = self->priv->low_value;
+  high = self->priv->high_value;
 
   /* if no base icon return NULL */
   if (!base_name)
@@ -548,36 +798,41 @@ get_icon_path(IsSensor *self)
     goto out;
   }
 
-  /* no range - return base icon */
-  if (fabs(low - high) <= DBL_EPSILON)
+  /* no range or not one of our stock icons - return base icon */
+  entry = icon_cache_lookup(base_name);
+  if (fabs(low - high) <= DBL_EPSILON || !entry)
   {
-    /* use base_name */
-    icon_path = g_strdup(base_name);
+    icon_path = base_name;
     goto out;
   }
 
-  overlay_name = value_overlay_icon(value, low, high);
-  cache_dir = g_build_filename(g_get_user_cache_dir(),
-                               PACKAGE, "icons", NULL);
-  icon_name = g_strdup_printf("%s-%s.png", base_name, overlay_name);
-  icon_path = g_build_filename(cache_dir, icon_name, NULL);
-  g_free(icon_name);
-  g_free(cache_dir);
+  range = sensor_value_range(self->priv->value, low, high);
+  icon_path = entry->icon_paths[range];
+  if (icon_path)
+  {
+    goto out;
+  }
 
   /* prepare cache icon */
-  ret = prepare_cache_icon(base_name, overlay_name, icon_path, &error);
+  overlay_name = value_overlay_icons[range];
+  path = cache_icon_path(base_name, overlay_name);
+  ret = prepare_cache_icon(base_name, overlay_name, path, &error);
   if (!ret)
   {
     is_warning("sensor", "Couldn't create cache icon %s from base %s and overlay %s for sensor %s: %s",
-               icon_path, base_name, overlay_name,
+               path, base_name, overlay_name,
                is_sensor_get_path(self),
                error ? error->message : "NO ERROR");
     g_clear_error(&error);
-    /* return base_name instead */
-    g_free(icon_path);
-    icon_path = g_strdup(base_name);
-    goto out;
+    /* use base_name instead - and remember so we don't try again */
+    icon_path = base_name;
+  }
+  else
+  {
+    icon_path = g_intern_string(path);
   }
+  entry->icon_paths[range] = icon_path;
+  g_free(path);
 
 out:
   return icon_path;
@@ -586,16 +841,14 @@ out:
 static void
 update_icon_path(IsSensor *self)
 {
-  gchar *icon_path = get_icon_path(self);
-  if (g_strcmp0(icon_path, self->priv->icon_path))
+  const gchar *icon_path = get_icon_path(self);
+
+  /* all icon paths are interned */
+  if (icon_path != self->priv->icon_path)
   {
-    g_free(self->priv->icon_path);
     self->priv->icon_path = icon_path;
-    icon_path = NULL;
-    g_object_notify_by_pspec(G_OBJECT(self),
-                             properties[PROP_ICON_PATH]);
+    sensor_notify(self, PROP_ICON_PATH);
   }
-  g_free(icon_path);
 }
 
 static void
@@ -683,10 +936,13 @@ is_sensor_set_value(IsSensor *self,
 
   if (fabs(priv->value - value) > DBL_EPSILON)
   {
+    /* emit a single changed signal for value and icon-path */
+    is_sensor_freeze_changed(self);
     priv->value = value;
-    g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_VALUE]);
+    sensor_notify(self, PROP_VALUE);
     update_alarmed(self);
     update_icon_path(self);
+    is_sensor_thaw_changed(self);
   }
 }
 
@@ -710,7 +966,7 @@ is_sensor_set_digits(IsSensor *self,
   if (digits != priv->digits)
   {
     priv->digits = digits;
-    g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_DIGITS]);
+    sensor_notify(self, PROP_DIGITS);
   }
 }
 
@@ -734,7 +990,7 @@ is_sensor_set_alarm_value(IsSensor *self,
   if (fabs(priv->alarm_value - alarm_value) > DBL_EPSILON)
   {
     priv->alarm_value = alarm_value;
-    g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_ALARM_VALUE]);
+    sensor_notify(self, PROP_ALARM_VALUE);
     update_alarmed(self);
   }
 }
@@ -759,8 +1015,7 @@ is_sensor_set_alarm_mode(IsSensor *self,
   if (priv->alarm_mode != alarm_mode)
   {
     priv->alarm_mode = alarm_mode;
-    g_object_notify_by_pspec(G_OBJECT(self),
-                             properties[PROP_ALARM_MODE]);
+    sensor_notify(self, PROP_ALARM_MODE);
     update_alarmed(self);
   }
 }
@@ -781,7 +1036,7 @@ is_sensor_set_units(IsSensor *self,
   {
     g_free(self->priv->units);
     self->priv->units = units ? g_strdup(units) : NULL;
-    g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_UNITS]);
+    sensor_notify(self, PROP_UNITS);
   }
 }
 
@@ -800,8 +1055,7 @@ is_sensor_set_update_interval(IsSensor *self,
   if (self->priv->update_interval != update_interval)
   {
     self->priv->update_interval = update_interval;
-    g_object_notify_by_pspec(G_OBJECT(self),
-                             properties[PROP_UPDATE_INTERVAL]);
+    sensor_notify(self, PROP_UPDATE_INTERVAL);
   }
 }
 
@@ -812,24 +1066,42 @@ is_sensor_get_alarmed(IsSensor *self)
   return self->priv->alarmed;
 }
 
-void
+gboolean
 is_sensor_update_value(IsSensor *self)
 {
   IsSensorPrivate *priv;
-  gint64 secs;
+  gint64 now;
+  gboolean ret = FALSE;
 
-  g_return_if_fail(IS_IS_SENSOR(self));
+  g_return_val_if_fail(IS_IS_SENSOR(self), FALSE);
 
   priv = self->priv;
 
   /* respect update_interval */
-  secs = g_get_monotonic_time() / G_USEC_PER_SEC;
+  now = g_get_monotonic_time();
   if (!priv->last_update ||
-      secs - priv->last_update >= priv->update_interval)
+      now - priv->last_update >= (gint64)priv->update_interval * G_USEC_PER_SEC)
   {
-    priv->last_update = secs;
+    priv->last_update = now;
     g_signal_emit(self, signals[SIGNAL_UPDATE_VALUE], 0);
+    ret = TRUE;
   }
+  return ret;
+}
+
+void
+is_sensor_request_limits(IsSensor *self)
+{
+  g_return_if_fail(IS_IS_SENSOR(self));
+  g_signal_emit(self, signals[SIGNAL_REQUEST_LIMITS], 0);
+}
+
+/* monotonic time in usecs of the last update-value emission, or 0 if never */
+gint64
+is_sensor_get_last_update(IsSensor *self)
+{
+  g_return_val_if_fail(IS_IS_SENSOR(self), 0);
+  return self->priv->last_update;
 }
 
 const gchar *
@@ -844,11 +1116,13 @@ is_sensor_set_icon(IsSensor *self,
                    const gchar *icon)
 {
   g_return_if_fail(IS_IS_SENSOR(self));
-  if (g_strcmp0(icon, self->priv->icon) != 0)
+  /* icon names are interned so that they can be looked up quickly in the
+   * icon cache */
+  icon = g_intern_string(icon);
+  if (icon != self->priv->icon)
   {
-    g_free(self->priv->icon);
-    self->priv->icon = icon ? g_strdup(icon) : NULL;
-    g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_ICON]);
+    self->priv->icon = icon;
+    sensor_notify(self, PROP_ICON);
     update_icon_path(self);
   }
 }
@@ -873,7 +1147,7 @@ is_sensor_set_low_value(IsSensor *self,
   if (fabs(priv->low_value - low_value) > DBL_EPSILON)
   {
     priv->low_value = low_value;
-    g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_LOW_VALUE]);
+    sensor_notify(self, PROP_LOW_VALUE);
     update_icon_path(self);
   }
 }
@@ -898,7 +1172,7 @@ is_sensor_set_high_value(IsSensor *self,
   if (fabs(priv->high_value - high_value) > DBL_EPSILON)
   {
     priv->high_value = high_value;
-    g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_HIGH_VALUE]);
+    sensor_notify(self, PROP_HIGH_VALUE);
     update_icon_path(self);
   }
 }
@@ -946,6 +1220,253 @@ is_sensor_set_error(IsSensor *self,
       g_object_set_data_full(G_OBJECT(self), "error-notification",
                              notification, g_object_unref);
     }
-    g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_ERROR]);
+    sensor_notify(self, PROP_ERROR);
+  }
+}
+
+void
+is_sensor_freeze_changed(IsSensor *self)
+{
+  g_return_if_fail(IS_IS_SENSOR(self));
+  self->priv->changed_freeze_count++;
+}
+
+void
+is_sensor_thaw_changed(IsSensor *self)
+{
+  IsSensorPrivate *priv;
+
+  g_return_if_fail(IS_IS_SENSOR(self));
+
+  priv = self->priv;
+  g_return_if_fail(priv->changed_freeze_count > 0);
+
+  if (--priv->changed_freeze_count == 0)
+  {
+    emit_changed(self);
+  }
+}
+
+/* changes made while frozen are defaults (ie. limits read from the hardware)
+ * rather than choices of the user so are not saved to their config */
+void
+is_sensor_freeze_config(IsSensor *self)
+{
+  g_return_if_fail(IS_IS_SENSOR(self));
+  self->priv->config_freeze_count++;
+}
+
+void
+is_sensor_thaw_config(IsSensor *self)
+{
+  g_return_if_fail(IS_IS_SENSOR(self));
+  g_return_if_fail(self->priv->config_freeze_count > 0);
+  self->priv->config_freeze_count--;
+}
+
+gboolean
+is_sensor_get_config_frozen(IsSensor *self)
+{
+  g_return_val_if_fail(IS_IS_SENSOR(self), FALSE);
+  return self->priv->config_freeze_count > 0;
+}
+
+typedef struct
+{
+  guint generation;
+  IconCacheEntry *entry;
+  SensorValueRange range;
+  gchar *base_file;
+  gchar *overlay_file;
+  gchar *icon_path;
+  gboolean ret;
+  GError *error;
+} IconCacheJob;
+
+static void
+icon_cache_job_free(IconCacheJob *job)
+{
+  g_free(job->base_file);
+  g_free(job->overlay_file);
+  g_free(job->icon_path);
+  g_clear_error(&job->error);
+  g_slice_free(IconCacheJob, job);
+}
+
+/* called back in the main loop once a job has completed */
+static gboolean
+icon_cache_job_done(IconCacheJob *job)
+{
+  if (job->generation != icon_cache_generation)
+  {
+    goto out;
+  }
+  if (!job->ret)
+  {
+    /* leave entry unset so is tried again on demand */
+    is_warning("sensor", "Couldn't create cache icon %s from %s and %s: %s",
+               job->icon_path, job->base_file, job->overlay_file,
+               job->error ? job->error->message : "NO ERROR");
+    goto out;
+  }
+  if (!job->entry->icon_paths[job->range])
+  {
+    GList *l;
+
+    job->entry->icon_paths[job->range] = g_intern_string(job->icon_path);
+    /* move over any sensors which want this icon now it is cached - if the
+     * icon theme changed they are still showing one which was removed */
+    for (l = live_sensors; l != NULL; l = l->next)
+    {
+      IsSensor *sensor = IS_SENSOR(l->data);
+      IsSensorPrivate *priv = sensor->priv;
+
+      if (priv->icon == job->entry->base_name &&
+          fabs(priv->low_value - priv->high_value) > DBL_EPSILON &&
+          sensor_value_range(priv->value, priv->low_value,
+                             priv->high_value) == job->range)
+      {
+        update_icon_path(sensor);
+      }
+    }
+  }
+
+out:
+  icon_cache_job_free(job);
+  return FALSE;
+}
+
+/* runs in a thread pool so only loads icons directly from the files found
+ * in the main thread since GtkIconTheme is not thread-safe */
+static void
+icon_cache_job_run(IconCacheJob *job,
+                   gpointer data)
+{
+  GdkPixbuf *base_icon = NULL, *overlay_icon = NULL;
+
+  job->ret = g_file_test(job->icon_path,
+                         G_FILE_TEST_EXISTS | G_FILE_TEST_IS_REGULAR);
+  if (job->ret)
+  {
+    goto out;
+  }
+  base_icon = gdk_pixbuf_new_from_file_at_size(job->base_file,
+                                               DEFAULT_ICON_SIZE,
+                                               DEFAULT_ICON_SIZE,
+                                               &job->error);
+  if (!base_icon)
+  {
+    goto out;
+  }
+  overlay_icon = gdk_pixbuf_new_from_file_at_size(job->overlay_file,
+                                                  DEFAULT_ICON_SIZE,
+                                                  DEFAULT_ICON_SIZE,
+                                                  &job->error);
+  if (!overlay_icon)
+  {
+    goto out;
+  }
+  job->ret = composite_cache_icon(base_icon, overlay_icon, job->icon_path,
+                                  &job->error);
+
+out:
+  g_clear_object(&overlay_icon);
+  g_clear_object(&base_icon);
+  g_idle_add((GSourceFunc)icon_cache_job_done, job);
+}
+
+static gchar *
+icon_theme_get_filename(GtkIconTheme *icon_theme,
+                        const gchar *icon_name)
+{
+  GtkIconInfo *info;
+  gchar *filename = NULL;
+
+  info = gtk_icon_theme_lookup_icon(icon_theme, icon_name,
+                                    DEFAULT_ICON_SIZE, 0);
+  if (info)
+  {
+    filename = g_strdup(gtk_icon_info_get_filename(info));
+    g_object_unref(info);
+  }
+  return filename;
+}
+
+static void
+icon_theme_changed(GtkIconTheme *icon_theme,
+                   gpointer data)
+{
+  is_debug("sensor", "Icon theme changed - regenerating icon cache");
+  /* sensors are moved over to the new icons as each is cached */
+  sensor_prepare_cache_icons();
+}
+
+/* composite every stock icon with every value overlay in a thread pool so
+ * that sensors never have to do this themselves in the main loop - icons
+ * already cached for the current icon theme are reused */
+void
+sensor_prepare_cache_icons(void)
+{
+  static gboolean connected = FALSE;
+  GtkIconTheme *icon_theme;
+  GThreadPool *pool;
+  gchar *overlay_files[NUM_OVERLAY_ICONS];
+  guint i, j;
+
+  icon_theme = gtk_icon_theme_get_default();
+  if (!connected)
+  {
+    g_signal_connect(icon_theme, "changed",
+                     G_CALLBACK(icon_theme_changed), NULL);
+    connected = TRUE;
+  }
+
+  icon_cache_reset();
+
+  for (j = 0; j < NUM_OVERLAY_ICONS; j++)
+  {
+    overlay_files[j] = icon_theme_get_filename(icon_theme,
+                                               value_overlay_icons[j]);
+  }
+
+  pool = g_thread_pool_new((GFunc)icon_cache_job_run, NULL,
+                           g_get_num_processors(), FALSE, NULL);
+  for (i = 0; i < NUM_STOCK_ICONS; i++)
+  {
+    IconCacheEntry *entry;
+    gchar *base_file;
+
+    entry = icon_cache_lookup(g_intern_static_string(stock_icons[i]));
+    base_file = icon_theme_get_filename(icon_theme, stock_icons[i]);
+    if (!base_file)
+    {
+      continue;
+    }
+    for (j = 0; j < NUM_OVERLAY_ICONS; j++)
+    {
+      IconCacheJob *job;
+
+      if (!overlay_files[j])
+      {
+        continue;
+      }
+      job = g_slice_new0(IconCacheJob);
+      job->generation = icon_cache_generation;
+      job->entry = entry;
+      job->range = (SensorValueRange)j;
+      job->base_file = g_strdup(base_file);
+      job->overlay_file = g_strdup(overlay_files[j]);
+      job->icon_path = cache_icon_path(stock_icons[i],
+                                       value_overlay_icons[j]);
+      g_thread_pool_push(pool, job, NULL);
+    }
+    g_free(base_file);
+  }
+  /* let any queued jobs finish in the background */
+  g_thread_pool_free(pool, FALSE, FALSE);
+
+  for (j = 0; j < NUM_OVERLAY_ICONS; j++)
+  {
+    g_free(overlay_files[j]);
   }
 }
@@ -54,6 +54,8 @@ struct _IsSensorClass
   GObjectClass parent_class;
   /* signals */
   void (*update_value)(IsSensor *sensor);
+  void (*changed)(IsSensor *sensor, guint changed);
+  void (*request_limits)(IsSensor *sensor);
 };
 
 struct _IsSensor
@@ -69,6 +71,24 @@ typedef enum
   IS_SENSOR_ALARM_MODE_HIGH,
 } IsSensorAlarmMode;
 
+/* flags passed to the changed signal */
+typedef enum
+{
+  IS_SENSOR_CHANGED_LABEL = 1 << 0,
+  IS_SENSOR_CHANGED_VALUE = 1 << 1,
+  IS_SENSOR_CHANGED_DIGITS = 1 << 2,
+  IS_SENSOR_CHANGED_ALARM_VALUE = 1 << 3,
+  IS_SENSOR_CHANGED_ALARM_MODE = 1 << 4,
+  IS_SENSOR_CHANGED_UNITS = 1 << 5,
+  IS_SENSOR_CHANGED_UPDATE_INTERVAL = 1 << 6,
+  IS_SENSOR_CHANGED_ALARMED = 1 << 7,
+  IS_SENSOR_CHANGED_ICON = 1 << 8,
+  IS_SENSOR_CHANGED_LOW_VALUE = 1 << 9,
+  IS_SENSOR_CHANGED_HIGH_VALUE = 1 << 10,
+  IS_SENSOR_CHANGED_ICON_PATH = 1 << 11,
+  IS_SENSOR_CHANGED_ERROR = 1 << 12,
+} IsSensorChangedFlags;
+
 /* device icons */
 #define IS_STOCK_CPU "indicator-sensors-cpu"
 #define IS_STOCK_DISK "indicator-sensors-disk"
@@ -83,7 +103,9 @@ typedef enum
 
 GType is_sensor_get_type(void) G_GNUC_CONST;
 IsSensor *is_sensor_new(const gchar *path);
-void is_sensor_update_value(IsSensor *self);
+gboolean is_sensor_update_value(IsSensor *self);
+gint64 is_sensor_get_last_update(IsSensor *self);
+void is_sensor_request_limits(IsSensor *self);
 const gchar *is_sensor_get_path(IsSensor *self);
 const gchar *is_sensor_get_label(IsSensor *self);
 void is_sensor_set_label(IsSensor *self, const gchar *label);
@@ -109,8 +131,13 @@ void is_sensor_set_high_value(IsSensor *self, gdouble value);
 const gchar *is_sensor_get_icon_path(IsSensor *self);
 const gchar *is_sensor_get_error(IsSensor *self);
 void is_sensor_set_error(IsSensor *self, const gchar *error);
+void is_sensor_freeze_changed(IsSensor *self);
+void is_sensor_thaw_changed(IsSensor *self);
+void is_sensor_freeze_config(IsSensor *self);
+void is_sensor_thaw_config(IsSensor *self);
+gboolean is_sensor_get_config_frozen(IsSensor *self);
 
-void sensor_prepare_cache_icons();
+void sensor_prepare_cache_icons(void);
 
 G_END_DECLS
 
@@ -18,6 +18,7 @@
 #include "is-store.h"
 #include "is-log.h"
 #include <gtk/gtk.h>
+#include <string.h>
 
 static void is_store_dispose(GObject *object);
 static void is_store_finalize(GObject *object);
@@ -66,8 +67,12 @@ struct _IsStoreEntry
   /* entry a path name and other entries, and a
      sensor + enabled value if it is a leaf sensor */
   gchar *name;
+  /* full path of this entry (ie. key in the path index) */
+  gchar *path;
 
   GSequence *entries;
+  /* entries indexed by name */
+  GHashTable *children;
 
   IsSensor *sensor;
   gboolean enabled;
@@ -84,23 +89,33 @@ entry_free(IsStoreEntry *entry)
   {
     g_object_unref(entry->sensor);
   }
+  g_hash_table_destroy(entry->children);
   g_sequence_free(entry->entries);
+  g_free(entry->path);
   g_free(entry->name);
   g_slice_free(IsStoreEntry, entry);
 }
 
 static IsStoreEntry *
-entry_new(const gchar *name)
+entry_new(const gchar *name,
+          const gchar *path)
 {
   IsStoreEntry *entry = g_slice_new0(IsStoreEntry);
   entry->name = g_strdup(name);
+  entry->path = g_strdup(path);
   entry->entries = g_sequence_new((GDestroyNotify)entry_free);
+  /* keys and values are owned by the entries themselves */
+  entry->children = g_hash_table_new(g_str_hash, g_str_equal);
   return entry;
 }
 
 struct _IsStorePrivate
 {
   GSequence *entries;
+  /* top-level entries indexed by name */
+  GHashTable *children;
+  /* all entries indexed by their full path */
+  GHashTable *paths;
   gint stamp;
 };
 
@@ -124,6 +139,8 @@ is_store_init(IsStore *self)
 
   self->priv = priv;
   priv->entries = g_sequence_new((GDestroyNotify)entry_free);
+  priv->children = g_hash_table_new(g_str_hash, g_str_equal);
+  priv->paths = g_hash_table_new(g_str_hash, g_str_equal);
   priv->stamp = g_random_int();
 }
 
@@ -147,6 +164,9 @@ is_store_finalize(GObject *object)
   IsStore *self = (IsStore *)object;
   IsStorePrivate *priv = self->priv;
 
+  /* indexes don't own anything so destroy them first */
+  g_hash_table_destroy(priv->paths);
+  g_hash_table_destroy(priv->children);
   g_sequence_free(priv->entries);
 
   /* Make compiler happy */
@@ -563,45 +583,7 @@ static IsStoreEntry *
 find_entry(IsStore *self,
            const gchar *path)
 {
-  IsStorePrivate *priv;
-  GSequence *entries;
-  GSequenceIter *iter;
-  IsStoreEntry *entry = NULL;
-  gchar **names;
-  int i;
-
-  priv = self->priv;
-
-  entries = priv->entries;
-  names = g_strsplit(path, "/", 0);
-
-  /* iterate through name components */
-  for (i = 0; names[i] != NULL; i++)
-  {
-    const gchar *name = names[i];
-
-    entry = NULL;
-
-    for (iter = g_sequence_get_begin_iter(entries);
-         !g_sequence_iter_is_end(iter);
-         iter = g_sequence_iter_next(iter))
-    {
-      entry = (IsStoreEntry *)g_sequence_get(iter);
-      if (g_strcmp0(entry->name, name) == 0)
-      {
-        entries = entry->entries;
-        break;
-      }
-      entry = NULL;
-    }
-    if (!entry)
-    {
-      /* no entry exists with this name component */
-      break;
-    }
-  }
-  g_strfreev(names);
-  return entry;
+  return (IsStoreEntry *)g_hash_table_lookup(self->priv->paths, path);
 }
 
 IsStore *
@@ -617,11 +599,11 @@ is_store_add_sensor(IsStore *self,
 {
   IsStorePrivate *priv;
   GSequence *entries;
+  GHashTable *children;
   IsStoreEntry *entry = NULL;
   GSequenceIter *parent = NULL;
-  gchar **names = NULL;
-  int i;
-  GtkTreePath *path;
+  gchar *path, *name, *sep;
+  GtkTreePath *tree_path;
   GtkTreeIter _iter;
   gboolean ret = FALSE;
 
@@ -638,62 +620,63 @@ is_store_add_sensor(IsStore *self,
   }
 
   entries = priv->entries;
-  names = g_strsplit(is_sensor_get_path(sensor), "/", 0);
-  /* otherwise iterate through to create the entry */
-  for (i = 0; names[i] != NULL; i++)
+  children = priv->children;
+  /* walk the path one name component at a time - terminate path at each
+   * separator in turn so the prefix up to it can be used as the index key
+   * for the entry at that level */
+  path = g_strdup(is_sensor_get_path(sensor));
+  name = path;
+  do
   {
-    GSequenceIter *seq_iter;
-    gchar *name = names[i];
-
-    entry = NULL;
-
-    for (seq_iter = g_sequence_get_begin_iter(entries);
-         !g_sequence_iter_is_end(seq_iter);
-         seq_iter = g_sequence_iter_next(seq_iter))
+    sep = strchr(name, '/');
+    if (sep)
     {
-      entry = (IsStoreEntry *)g_sequence_get(seq_iter);
-      if (g_strcmp0(entry->name, name) == 0)
-      {
-        entries = entry->entries;
-        parent = seq_iter;
-        break;
-      }
-      entry = NULL;
+      *sep = '\0';
     }
+
+    entry = (IsStoreEntry *)g_hash_table_lookup(children, name);
     if (!entry)
     {
       /* create entry for this name component */
-      entry = entry_new(name);
+      entry = entry_new(name, path);
       entry->iter = g_sequence_append(entries, entry);
       entry->parent = parent;
-      entries = entry->entries;
+      g_hash_table_insert(children, entry->name, entry);
+      g_hash_table_insert(priv->paths, entry->path, entry);
       _iter.stamp = priv->stamp;
       _iter.user_data = entry->iter;
-      path = gtk_tree_model_get_path(GTK_TREE_MODEL(self),
-                                     &_iter);
-      gtk_tree_model_row_inserted(GTK_TREE_MODEL(self), path,
+      tree_path = gtk_tree_model_get_path(GTK_TREE_MODEL(self),
+                                          &_iter);
+      gtk_tree_model_row_inserted(GTK_TREE_MODEL(self), tree_path,
                                   &_iter);
-      gtk_tree_path_free(path);
-      /* parent of the next entry we create will be this
-       * entry */
-      parent = entry->iter;
+      gtk_tree_path_free(tree_path);
+    }
+    /* next entry is a child of this one */
+    entries = entry->entries;
+    children = entry->children;
+    parent = entry->iter;
+
+    if (sep)
+    {
+      *sep = '/';
+      name = sep + 1;
     }
   }
-  g_strfreev(names);
+  while (sep);
+  g_free(path);
 
   g_assert(entry);
-  g_assert(find_entry(self, is_sensor_get_path(sensor)) == entry);
 
   is_debug("store", "inserted sensor %s with label %s",
            is_sensor_get_path(sensor), is_sensor_get_label(sensor));
   entry->sensor = g_object_ref(sensor);
   _iter.stamp = priv->stamp;
   _iter.user_data = entry->iter;
-  path = gtk_tree_model_get_path(GTK_TREE_MODEL(self),
-                                 &_iter);
-  gtk_tree_model_row_changed(GTK_TREE_MODEL(self), path,
+  tree_path = gtk_tree_model_get_path(GTK_TREE_MODEL(self),
+                                      &_iter);
+  gtk_tree_model_row_changed(GTK_TREE_MODEL(self), tree_path,
                              &_iter);
-  gtk_tree_path_free(path);
+  gtk_tree_path_free(tree_path);
   /* return a copy of iter */
   if (iter != NULL)
   {
@@ -706,6 +689,21 @@ out:
   return ret;
 }
 
+static void
+unindex_entry(IsStore *self,
+              IsStoreEntry *entry)
+{
+  GSequenceIter *iter;
+
+  for (iter = g_sequence_get_begin_iter(entry->entries);
+       !g_sequence_iter_is_end(iter);
+       iter = g_sequence_iter_next(iter))
+  {
+    unindex_entry(self, (IsStoreEntry *)g_sequence_get(iter));
+  }
+  g_hash_table_remove(self->priv->paths, entry->path);
+}
+
 static void
 remove_entry(IsStore *self,
              IsStoreEntry *entry)
@@ -718,6 +716,13 @@ remove_entry(IsStore *self,
   priv = self->priv;
 
   parent_iter = entry->parent;
+  /* drop entry and all its descendants from the indexes before they get
+   * freed by removing entry from its sequence */
+  unindex_entry(self, entry);
+  g_hash_table_remove(parent_iter ?
+                      ((IsStoreEntry *)g_sequence_get(parent_iter))->children :
+                      priv->children,
+                      entry->name);
   iter.stamp = priv->stamp;
   iter.user_data = entry->iter;
   path = gtk_tree_model_get_path(GTK_TREE_MODEL(self), &iter);
@@ -843,6 +848,82 @@ is_store_remove(IsStore *self,
   return TRUE;
 }
 
+static guint
+entry_depth(IsStoreEntry *entry)
+{
+  guint depth = 0;
+
+  while (entry->parent)
+  {
+    entry = (IsStoreEntry *)g_sequence_get(entry->parent);
+    depth++;
+  }
+  return depth;
+}
+
+/* compares the position of a and b in the store in the same order as
+ * gtk_tree_path_compare() would but without having to build paths */
+gint
+is_store_compare_iters(IsStore *self,
+                       GtkTreeIter *a,
+                       GtkTreeIter *b)
+{
+  IsStorePrivate *priv;
+  GSequenceIter *a_iter, *b_iter;
+  IsStoreEntry *a_entry, *b_entry;
+  guint a_depth, b_depth;
+  gint ret = 0;
+
+  g_return_val_if_fail(IS_IS_STORE(self), 0);
+  g_return_val_if_fail(a != NULL && b != NULL, 0);
+
+  priv = self->priv;
+
+  g_return_val_if_fail(a->stamp == priv->stamp, 0);
+  g_return_val_if_fail(b->stamp == priv->stamp, 0);
+
+  a_iter = (GSequenceIter *)a->user_data;
+  b_iter = (GSequenceIter *)b->user_data;
+  a_entry = (IsStoreEntry *)g_sequence_get(a_iter);
+  b_entry = (IsStoreEntry *)g_sequence_get(b_iter);
+  a_depth = entry_depth(a_entry);
+  b_depth = entry_depth(b_entry);
+
+  /* bring the deeper of the two up to the same level - if it is then a
+   * descendant of the other it sorts after it */
+  while (a_depth > b_depth)
+  {
+    a_iter = a_entry->parent;
+    a_entry = (IsStoreEntry *)g_sequence_get(a_iter);
+    a_depth--;
+    ret = 1;
+  }
+  while (b_depth > a_depth)
+  {
+    b_iter = b_entry->parent;
+    b_entry = (IsStoreEntry *)g_sequence_get(b_iter);
+    b_depth--;
+    ret = -1;
+  }
+  if (a_iter == b_iter)
+  {
+    goto out;
+  }
+
+  /* then walk both up until they are siblings */
+  while (a_entry->parent != b_entry->parent)
+  {
+    a_iter = a_entry->parent;
+    a_entry = (IsStoreEntry *)g_sequence_get(a_iter);
+    b_iter = b_entry->parent;
+    b_entry = (IsStoreEntry *)g_sequence_get(b_iter);
+  }
+  ret = g_sequence_iter_compare(a_iter, b_iter);
+
+out:
+  return ret;
+}
+
 gboolean is_store_get_iter(IsStore *self,
                            const gchar *path,
                            GtkTreeIter *iter)
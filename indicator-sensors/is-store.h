@@ -89,6 +89,9 @@ gboolean is_store_set_enabled(IsStore *self,
 gboolean is_store_get_iter(IsStore *self,
                            const gchar *path,
                            GtkTreeIter *iter);
+gint is_store_compare_iters(IsStore *self,
+                            GtkTreeIter *a,
+                            GtkTreeIter *b);
 #define is_store_get_iter_for_sensor(self, sensor, iter) \
   is_store_get_iter(self,       \
                     is_sensor_get_path(sensor), \
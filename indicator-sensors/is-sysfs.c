@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2011-2019 Alex Murray <murray.alex@gmail.com>
+ *
+ * indicator-sensors is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * indicator-sensors is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with indicator-sensors.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "is-sysfs.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/* large enough for any 64-bit integer attribute plus sign and newline */
+#define READ_BUF_SIZE 24
+
+gint
+is_sysfs_open(const gchar *dir,
+              const gchar *name)
+{
+  gchar *path;
+  gint fd;
+
+  path = g_build_filename(dir, name, NULL);
+  do
+  {
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+  }
+  while (fd < 0 && errno == EINTR);
+  g_free(path);
+  return fd;
+}
+
+void
+is_sysfs_close(gint fd)
+{
+  if (fd >= 0)
+  {
+    close(fd);
+  }
+}
+
+/* parses a decimal integer as written by the kernel - optional leading
+ * whitespace and sign followed by digits and then a newline or end */
+gboolean
+is_sysfs_parse_int(const gchar *buf,
+                   gsize len,
+                   gint64 *value)
+{
+  const gchar *end = buf + len;
+  guint64 result = 0;
+  gboolean negative = FALSE;
+  gboolean ret = FALSE;
+
+  while (buf < end && (*buf == ' ' || *buf == '\t'))
+  {
+    buf++;
+  }
+  if (buf < end && (*buf == '-' || *buf == '+'))
+  {
+    negative = (*buf == '-');
+    buf++;
+  }
+  while (buf < end && *buf >= '0' && *buf <= '9')
+  {
+    result = (result * 10) + (guint64)(*buf - '0');
+    buf++;
+    ret = TRUE;
+  }
+  if (buf < end && *buf != '\n' && *buf != '\0')
+  {
+    ret = FALSE;
+  }
+  if (ret)
+  {
+    *value = negative ? -(gint64)result : (gint64)result;
+  }
+  return ret;
+}
+
+/* reads an integer attribute from the start of an already open fd - on
+ * failure returns FALSE with errno set */
+gboolean
+is_sysfs_read_int(gint fd,
+                  gint64 *value)
+{
+  gchar buf[READ_BUF_SIZE];
+  gssize len;
+
+  do
+  {
+    len = pread(fd, buf, sizeof(buf), 0);
+  }
+  while (len < 0 && errno == EINTR);
+
+  if (len < 0)
+  {
+    return FALSE;
+  }
+  if (!is_sysfs_parse_int(buf, (gsize)len, value))
+  {
+    errno = EINVAL;
+    return FALSE;
+  }
+  return TRUE;
+}
+
+/* one-off read of an integer attribute, for use when discovering devices */
+gboolean
+is_sysfs_get_int(const gchar *dir,
+                 const gchar *name,
+                 gint64 *value)
+{
+  gint fd;
+  gboolean ret;
+
+  fd = is_sysfs_open(dir, name);
+  if (fd < 0)
+  {
+    return FALSE;
+  }
+  ret = is_sysfs_read_int(fd, value);
+  is_sysfs_close(fd);
+  return ret;
+}
+
+/* one-off read of a string attribute with surrounding whitespace removed */
+gchar *
+is_sysfs_get_string(const gchar *dir,
+                    const gchar *name)
+{
+  gchar *path, *contents = NULL;
+
+  path = g_build_filename(dir, name, NULL);
+  if (g_file_get_contents(path, &contents, NULL, NULL))
+  {
+    g_strstrip(contents);
+  }
+  g_free(path);
+  return contents;
+}
+
+/* whether the temperature of disk (ie. sda) is provided by the drivetemp
+ * hwmon driver - if so it is read by the storage plugin without going via
+ * udisks */
+gboolean
+is_sysfs_disk_has_drivetemp(const gchar *disk)
+{
+  gchar *dir;
+  const gchar *entry;
+  GDir *gdir;
+  gboolean ret = FALSE;
+
+  dir = g_build_filename("/sys/class/block", disk, "device", "hwmon", NULL);
+  gdir = g_dir_open(dir, 0, NULL);
+  if (!gdir)
+  {
+    goto out;
+  }
+  while (!ret && (entry = g_dir_read_name(gdir)) != NULL)
+  {
+    gchar *hwmon, *name;
+
+    hwmon = g_build_filename(dir, entry, NULL);
+    name = is_sysfs_get_string(hwmon, "name");
+    ret = (g_strcmp0(name, "drivetemp") == 0);
+    g_free(name);
+    g_free(hwmon);
+  }
+  g_dir_close(gdir);
+
+out:
+  g_free(dir);
+  return ret;
+}
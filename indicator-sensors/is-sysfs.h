@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2011-2019 Alex Murray <murray.alex@gmail.com>
+ *
+ * indicator-sensors is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * indicator-sensors is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with indicator-sensors.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __IS_SYSFS_H__
+#define __IS_SYSFS_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* helpers for sampling sysfs attributes - attributes are opened once and
+ * then re-read from the start with pread() on each sample */
+gint is_sysfs_open(const gchar *dir,
+                   const gchar *name);
+void is_sysfs_close(gint fd);
+gboolean is_sysfs_read_int(gint fd,
+                           gint64 *value);
+gboolean is_sysfs_parse_int(const gchar *buf,
+                            gsize len,
+                            gint64 *value);
+gboolean is_sysfs_get_int(const gchar *dir,
+                          const gchar *name,
+                          gint64 *value);
+gchar *is_sysfs_get_string(const gchar *dir,
+                           const gchar *name);
+gboolean is_sysfs_disk_has_drivetemp(const gchar *disk);
+
+G_END_DECLS
+
+#endif /* __IS_SYSFS_H__ */
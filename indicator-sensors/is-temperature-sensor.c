@@ -233,13 +233,14 @@ void is_temperature_sensor_set_scale(IsTemperatureSensor *self,
 
 }
 
-void
-is_temperature_sensor_set_celsius_value(IsTemperatureSensor *self,
-                                        gdouble value)
+/* converts a value in celsius to the current scale of the sensor */
+gdouble
+is_temperature_sensor_from_celsius(IsTemperatureSensor *self,
+                                   gdouble value)
 {
   IsTemperatureSensorPrivate *priv;
 
-  g_return_if_fail(IS_IS_TEMPERATURE_SENSOR(self));
+  g_return_val_if_fail(IS_IS_TEMPERATURE_SENSOR(self), value);
 
   priv = self->priv;
 
@@ -257,5 +258,15 @@ is_temperature_sensor_set_celsius_value(IsTemperatureSensor *self,
     default:
       g_assert_not_reached();
   }
-  is_sensor_set_value(IS_SENSOR(self), value);
+  return value;
+}
+
+void
+is_temperature_sensor_set_celsius_value(IsTemperatureSensor *self,
+                                        gdouble value)
+{
+  g_return_if_fail(IS_IS_TEMPERATURE_SENSOR(self));
+
+  is_sensor_set_value(IS_SENSOR(self),
+                      is_temperature_sensor_from_celsius(self, value));
 }
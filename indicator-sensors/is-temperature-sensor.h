@@ -74,6 +74,8 @@ void is_temperature_sensor_set_scale(IsTemperatureSensor *sensor,
 IsTemperatureSensorScale is_temperature_sensor_get_scale(IsTemperatureSensor *sensor);
 void is_temperature_sensor_set_celsius_value(IsTemperatureSensor *sensor,
     gdouble value);
+gdouble is_temperature_sensor_from_celsius(IsTemperatureSensor *sensor,
+    gdouble value);
 
 G_END_DECLS
 
@@ -0,0 +1,561 @@
+/*
+ * Copyright (C) 2011-2019 Alex Murray <murray.alex@gmail.com>
+ *
+ * indicator-sensors is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * indicator-sensors is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with indicator-sensors.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "is-amdgpu-plugin.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <indicator-sensors/is-temperature-sensor.h>
+#include <indicator-sensors/is-fan-sensor.h>
+#include <indicator-sensors/is-power-sensor.h>
+#include <indicator-sensors/is-application.h>
+#include <indicator-sensors/is-sysfs.h>
+#include <indicator-sensors/is-log.h>
+#include <glib/gi18n.h>
+
+#define AMDGPU_PATH_PREFIX "amdgpu"
+#define DRM_CLASS_DIR "sys/class/drm"
+#define DEFAULT_SYSFS_ROOT "/"
+
+static void peas_activatable_iface_init(PeasActivatableInterface *iface);
+
+G_DEFINE_DYNAMIC_TYPE_EXTENDED(IsAmdgpuPlugin,
+                               is_amdgpu_plugin,
+                               PEAS_TYPE_EXTENSION_BASE,
+                               0,
+                               G_IMPLEMENT_INTERFACE_DYNAMIC(PEAS_TYPE_ACTIVATABLE,
+                                   peas_activatable_iface_init));
+
+enum
+{
+  PROP_OBJECT = 1,
+  PROP_SYSFS_ROOT,
+};
+
+struct _IsAmdgpuPluginPrivate
+{
+  IsApplication *application;
+  gchar *sysfs_root;
+};
+
+typedef enum
+{
+  AMDGPU_TYPE_TEMP = 0,
+  AMDGPU_TYPE_FAN,
+  AMDGPU_TYPE_POWER,
+  AMDGPU_TYPE_VOLTAGE,
+  AMDGPU_TYPE_BUSY,
+} AmdgpuType;
+
+/* bound to each sensor as the user data for its update-value handler so
+ * reading a sample is a single pread() */
+typedef struct
+{
+  gint fd;
+  gdouble scale;
+  AmdgpuType type;
+} AmdgpuInput;
+
+static void is_amdgpu_plugin_finalize(GObject *object);
+
+static void
+is_amdgpu_plugin_set_property(GObject *object,
+                              guint prop_id,
+                              const GValue *value,
+                              GParamSpec *pspec)
+{
+  IsAmdgpuPlugin *plugin = IS_AMDGPU_PLUGIN(object);
+
+  switch (prop_id)
+  {
+    case PROP_OBJECT:
+      plugin->priv->application = IS_APPLICATION(g_value_dup_object(value));
+      break;
+
+    case PROP_SYSFS_ROOT:
+      g_free(plugin->priv->sysfs_root);
+      plugin->priv->sysfs_root = g_value_dup_string(value);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+is_amdgpu_plugin_get_property(GObject *object,
+                              guint prop_id,
+                              GValue *value,
+                              GParamSpec *pspec)
+{
+  IsAmdgpuPlugin *plugin = IS_AMDGPU_PLUGIN(object);
+
+  switch (prop_id)
+  {
+    case PROP_OBJECT:
+      g_value_set_object(value, plugin->priv->application);
+      break;
+
+    case PROP_SYSFS_ROOT:
+      g_value_set_string(value, plugin->priv->sysfs_root);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+is_amdgpu_plugin_init(IsAmdgpuPlugin *self)
+{
+  IsAmdgpuPluginPrivate *priv =
+    G_TYPE_INSTANCE_GET_PRIVATE(self, IS_TYPE_AMDGPU_PLUGIN,
+                                IsAmdgpuPluginPrivate);
+
+  self->priv = priv;
+  /* allow pointing at a copy of sysfs without rebuilding */
+  priv->sysfs_root = g_strdup(getenv("IS_AMDGPU_SYSFS_ROOT") ?
+                              getenv("IS_AMDGPU_SYSFS_ROOT") :
+                              DEFAULT_SYSFS_ROOT);
+}
+
+static void
+is_amdgpu_plugin_finalize(GObject *object)
+{
+  IsAmdgpuPlugin *self = IS_AMDGPU_PLUGIN(object);
+  IsAmdgpuPluginPrivate *priv = self->priv;
+
+  g_free(priv->sysfs_root);
+  if (priv->application)
+  {
+    g_object_unref(priv->application);
+    priv->application = NULL;
+  }
+  G_OBJECT_CLASS(is_amdgpu_plugin_parent_class)->finalize(object);
+}
+
+static void
+amdgpu_input_free(AmdgpuInput *input,
+                  GClosure *closure)
+{
+  is_sysfs_close(input->fd);
+  g_slice_free(AmdgpuInput, input);
+}
+
+static void
+update_sensor_value(IsSensor *sensor,
+                    AmdgpuInput *input)
+{
+  gint64 raw;
+  gdouble value;
+
+  if (!is_sysfs_read_int(input->fd, &raw))
+  {
+    const gchar *reason = g_strerror(errno);
+    gchar *error = g_strdup_printf(/* first placeholder is sensor name,
+                                    * second is error message */
+                                   _("Error getting sensor value for sensor %s: %s"),
+                                   is_sensor_get_path(sensor), reason);
+    is_sensor_set_error(sensor, error);
+    g_free(error);
+    goto out;
+  }
+  value = (gdouble)raw / input->scale;
+  if (input->type == AMDGPU_TYPE_TEMP)
+  {
+    is_temperature_sensor_set_celsius_value(IS_TEMPERATURE_SENSOR(sensor),
+                                            value);
+  }
+  else
+  {
+    is_sensor_set_value(sensor, value);
+  }
+  is_sensor_set_error(sensor, NULL);
+
+out:
+  return;
+}
+
+/* opens attr within dir and binds it to a new sensor of type at path - the
+ * sensor is returned for the caller to finish setting up and add, or NULL
+ * if the attribute does not exist */
+static IsSensor *
+add_input(const gchar *dir,
+          const gchar *attr,
+          const gchar *path,
+          AmdgpuType type,
+          gdouble scale)
+{
+  AmdgpuInput *input;
+  IsSensor *sensor;
+  gint fd;
+
+  fd = is_sysfs_open(dir, attr);
+  if (fd < 0)
+  {
+    if (errno != ENOENT)
+    {
+      is_warning("amdgpu", "could not open %s/%s: %s",
+                 dir, attr, g_strerror(errno));
+    }
+    return NULL;
+  }
+
+  switch (type)
+  {
+    case AMDGPU_TYPE_TEMP:
+      sensor = is_temperature_sensor_new(path);
+      is_sensor_set_icon(sensor, IS_STOCK_GPU);
+      break;
+
+    case AMDGPU_TYPE_FAN:
+      sensor = is_fan_sensor_new(path);
+      is_sensor_set_digits(sensor, 0);
+      break;
+
+    case AMDGPU_TYPE_POWER:
+      sensor = is_power_sensor_new(path);
+      is_sensor_set_icon(sensor, IS_STOCK_GPU);
+      break;
+
+    case AMDGPU_TYPE_VOLTAGE:
+      sensor = is_sensor_new(path);
+      /* display voltage readings to 2 decimal places like
+         sensors command */
+      is_sensor_set_digits(sensor, 2);
+      /* translators: V is the unit for Voltage, replace with
+         appropriate unit */
+      is_sensor_set_units(sensor, _("V"));
+      is_sensor_set_icon(sensor, IS_STOCK_GPU);
+      break;
+
+    case AMDGPU_TYPE_BUSY:
+    default:
+      sensor = is_sensor_new(path);
+      /* utilization is given as a percentage from 0 to 100 */
+      is_sensor_set_units(sensor, "%");
+      is_sensor_set_low_value(sensor, 0.0);
+      is_sensor_set_high_value(sensor, 100.0);
+      is_sensor_set_digits(sensor, 0);
+      is_sensor_set_icon(sensor, IS_STOCK_GPU);
+      break;
+  }
+
+  input = g_slice_new(AmdgpuInput);
+  input->fd = fd;
+  input->scale = scale;
+  input->type = type;
+  /* input is freed along with the handler when the sensor is */
+  g_signal_connect_data(sensor, "update-value",
+                        G_CALLBACK(update_sensor_value),
+                        input, (GClosureNotify)amdgpu_input_free, 0);
+  return sensor;
+}
+
+static void
+add_sensor(IsAmdgpuPlugin *self,
+           IsSensor *sensor,
+           const gchar *card,
+           const gchar *name)
+{
+  gchar *label;
+
+  /* translators: first placeholder is the drm card, eg. card0, second is
+   * what is measured, eg. edge */
+  label = g_strdup_printf(_("GPU %s %s"), card, name);
+  is_sensor_set_label(sensor, label);
+  g_free(label);
+  is_manager_add_sensor(is_application_get_manager(self->priv->application),
+                        sensor);
+  g_object_unref(sensor);
+}
+
+/* amdgpu exposes up to 3 temperatures - edge, junction and mem - each
+ * with its own label */
+static void
+process_temps(IsAmdgpuPlugin *self,
+              const gchar *hwmon,
+              const gchar *card)
+{
+  guint n;
+
+  for (n = 1; n <= 3; n++)
+  {
+    IsSensor *sensor;
+    gchar *attr, *label, *path;
+    gint64 crit;
+
+    attr = g_strdup_printf("temp%u_input", n);
+    path = g_strdup_printf(AMDGPU_PATH_PREFIX "/%s/temp%u", card, n);
+    sensor = add_input(hwmon, attr, path, AMDGPU_TYPE_TEMP, 1000.0);
+    g_free(path);
+    g_free(attr);
+    if (!sensor)
+    {
+      continue;
+    }
+    attr = g_strdup_printf("temp%u_crit", n);
+    if (is_sysfs_get_int(hwmon, attr, &crit) && crit > 0)
+    {
+      is_sensor_set_alarm_mode(sensor, IS_SENSOR_ALARM_MODE_HIGH);
+      is_sensor_set_alarm_value(sensor, (gdouble)crit / 1000.0);
+      is_sensor_set_high_value(sensor, (gdouble)crit / 1000.0);
+    }
+    g_free(attr);
+    attr = g_strdup_printf("temp%u_label", n);
+    label = is_sysfs_get_string(hwmon, attr);
+    g_free(attr);
+    add_sensor(self, sensor, card, (label && *label) ? label : _("Temperature"));
+    g_free(label);
+  }
+}
+
+/* and up to 2 voltages - vddgfx and, on APUs, vddnb */
+static void
+process_voltages(IsAmdgpuPlugin *self,
+                 const gchar *hwmon,
+                 const gchar *card)
+{
+  guint n;
+
+  for (n = 0; n <= 1; n++)
+  {
+    IsSensor *sensor;
+    gchar *attr, *label, *path;
+
+    attr = g_strdup_printf("in%u_input", n);
+    path = g_strdup_printf(AMDGPU_PATH_PREFIX "/%s/in%u", card, n);
+    /* millivolts */
+    sensor = add_input(hwmon, attr, path, AMDGPU_TYPE_VOLTAGE, 1000.0);
+    g_free(path);
+    g_free(attr);
+    if (!sensor)
+    {
+      continue;
+    }
+    attr = g_strdup_printf("in%u_label", n);
+    label = is_sysfs_get_string(hwmon, attr);
+    g_free(attr);
+    add_sensor(self, sensor, card, (label && *label) ? label : _("Voltage"));
+    g_free(label);
+  }
+}
+
+static void
+process_hwmon(IsAmdgpuPlugin *self,
+              const gchar *hwmon,
+              const gchar *card)
+{
+  IsSensor *sensor;
+  gchar *path;
+  gint64 cap;
+
+  process_temps(self, hwmon, card);
+  process_voltages(self, hwmon, card);
+
+  path = g_strdup_printf(AMDGPU_PATH_PREFIX "/%s/fan1", card);
+  sensor = add_input(hwmon, "fan1_input", path, AMDGPU_TYPE_FAN, 1.0);
+  g_free(path);
+  if (sensor)
+  {
+    add_sensor(self, sensor, card, _("Fan"));
+  }
+
+  /* older kernels only provide the average over the last second whereas
+   * newer ones may provide only the instantaneous value */
+  path = g_strdup_printf(AMDGPU_PATH_PREFIX "/%s/power1", card);
+  sensor = add_input(hwmon, "power1_average", path, AMDGPU_TYPE_POWER,
+                     1000000.0);
+  if (!sensor)
+  {
+    sensor = add_input(hwmon, "power1_input", path, AMDGPU_TYPE_POWER,
+                       1000000.0);
+  }
+  g_free(path);
+  if (sensor)
+  {
+    if (is_sysfs_get_int(hwmon, "power1_cap", &cap) && cap > 0)
+    {
+      is_sensor_set_high_value(sensor, (gdouble)cap / 1000000.0);
+    }
+    add_sensor(self, sensor, card, _("Power"));
+  }
+}
+
+static gboolean
+is_amdgpu_device(const gchar *device)
+{
+  gchar *link, *target, *driver;
+  gboolean ret = FALSE;
+
+  link = g_build_filename(device, "driver", NULL);
+  target = g_file_read_link(link, NULL);
+  if (target)
+  {
+    driver = g_path_get_basename(target);
+    ret = (strcmp(driver, "amdgpu") == 0);
+    g_free(driver);
+  }
+  g_free(target);
+  g_free(link);
+  return ret;
+}
+
+static void
+process_card(IsAmdgpuPlugin *self,
+             const gchar *drm,
+             const gchar *card)
+{
+  IsSensor *sensor;
+  gchar *device, *dir, *path;
+  const gchar *entry;
+  GDir *gdir;
+
+  device = g_build_filename(drm, card, "device", NULL);
+  if (!is_amdgpu_device(device))
+  {
+    is_debug("amdgpu", "ignoring %s as it is not driven by amdgpu", card);
+    goto out;
+  }
+
+  path = g_strdup_printf(AMDGPU_PATH_PREFIX "/%s/busy", card);
+  sensor = add_input(device, "gpu_busy_percent", path, AMDGPU_TYPE_BUSY,
+                     1.0);
+  g_free(path);
+  if (sensor)
+  {
+    add_sensor(self, sensor, card, _("Utilization"));
+  }
+
+  /* the hwmon directory is the only one beneath device/hwmon */
+  dir = g_build_filename(device, "hwmon", NULL);
+  gdir = g_dir_open(dir, 0, NULL);
+  if (gdir)
+  {
+    while ((entry = g_dir_read_name(gdir)) != NULL)
+    {
+      if (g_str_has_prefix(entry, "hwmon"))
+      {
+        gchar *hwmon = g_build_filename(dir, entry, NULL);
+        process_hwmon(self, hwmon, card);
+        g_free(hwmon);
+        break;
+      }
+    }
+    g_dir_close(gdir);
+  }
+  g_free(dir);
+
+out:
+  g_free(device);
+}
+
+static void
+is_amdgpu_plugin_activate(PeasActivatable *activatable)
+{
+  IsAmdgpuPlugin *self = IS_AMDGPU_PLUGIN(activatable);
+  IsAmdgpuPluginPrivate *priv = self->priv;
+  const gchar *entry;
+  gchar *drm;
+  GDir *dir;
+  GError *error = NULL;
+
+  /* discover all attributes once - each keeps its file open for the
+   * lifetime of its sensor so no process is spawned to read them */
+  drm = g_build_filename(priv->sysfs_root, DRM_CLASS_DIR, NULL);
+  dir = g_dir_open(drm, 0, &error);
+  if (!dir)
+  {
+    is_debug("amdgpu", "unable to find sensors: %s", error->message);
+    g_error_free(error);
+    goto out;
+  }
+  is_debug("amdgpu", "searching for sensors in %s", drm);
+  while ((entry = g_dir_read_name(dir)) != NULL)
+  {
+    /* skip connectors like card0-DP-1 */
+    if (g_str_has_prefix(entry, "card") && *(entry + 4) != '\0' &&
+        strspn(entry + 4, "0123456789") == strlen(entry + 4))
+    {
+      process_card(self, drm, entry);
+    }
+  }
+  g_dir_close(dir);
+
+out:
+  g_free(drm);
+}
+
+static void
+is_amdgpu_plugin_deactivate(PeasActivatable *activatable)
+{
+  IsAmdgpuPlugin *plugin = IS_AMDGPU_PLUGIN(activatable);
+  IsAmdgpuPluginPrivate *priv = plugin->priv;
+  IsManager *manager;
+
+  manager = is_application_get_manager(priv->application);
+  is_manager_remove_paths_with_prefix(manager, AMDGPU_PATH_PREFIX);
+}
+
+static void
+is_amdgpu_plugin_class_init(IsAmdgpuPluginClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+  g_type_class_add_private(klass, sizeof(IsAmdgpuPluginPrivate));
+
+  gobject_class->get_property = is_amdgpu_plugin_get_property;
+  gobject_class->set_property = is_amdgpu_plugin_set_property;
+  gobject_class->finalize = is_amdgpu_plugin_finalize;
+
+  g_object_class_override_property(gobject_class, PROP_OBJECT, "object");
+  g_object_class_install_property(gobject_class, PROP_SYSFS_ROOT,
+                                  g_param_spec_string("sysfs-root",
+                                                      "sysfs-root property",
+                                                      "Directory containing the sys tree to search for GPUs on activation.",
+                                                      DEFAULT_SYSFS_ROOT,
+                                                      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+peas_activatable_iface_init(PeasActivatableInterface *iface)
+{
+  iface->activate = is_amdgpu_plugin_activate;
+  iface->deactivate = is_amdgpu_plugin_deactivate;
+}
+
+static void
+is_amdgpu_plugin_class_finalize(IsAmdgpuPluginClass *klass)
+{
+  /* nothing to do */
+}
+
+G_MODULE_EXPORT void
+peas_register_types(PeasObjectModule *module)
+{
+  is_amdgpu_plugin_register_type(G_TYPE_MODULE(module));
+
+  peas_object_module_register_extension_type(module,
+      PEAS_TYPE_ACTIVATABLE,
+      IS_TYPE_AMDGPU_PLUGIN);
+}
@@ -24,6 +24,8 @@
 #include <stdio.h>
 #include <sys/types.h>
 #include <regex.h>
+#include <string.h>
+#include <gio/gio.h>
 #include <indicator-sensors/is-temperature-sensor.h>
 #include <indicator-sensors/is-fan-sensor.h>
 #include <indicator-sensors/is-application.h>
@@ -49,10 +51,38 @@ enum
 struct _IsATIConfigPluginPrivate
 {
   IsApplication *application;
-  GRegex *temperature_regex;
-  GRegex *fanspeed_regex;
+
+  /* bindings due to be read in the next run of aticonfig and those being
+   * read by the one in flight */
+  GPtrArray *pending;
+  GPtrArray *sampling;
+  /* AticonfigRequest for each aticonfig process of the run in flight */
+  GPtrArray *requests;
+  guint n_running;
+  GCancellable *cancellable;
 };
 
+/* bound to each sensor as the user data of its update-value handler */
+typedef struct
+{
+  IsATIConfigPlugin *plugin;
+  IsSensor *sensor;
+  gint gpu;
+  gboolean temperature;
+  /* whether in pending */
+  gboolean queued;
+} AticonfigBinding;
+
+/* a single aticonfig process - all temperatures are read at once (gpu is
+ * -1) but fanspeed has to be read for each gpu separately */
+typedef struct
+{
+  IsATIConfigPlugin *plugin;
+  gint gpu;
+  gchar *output;
+  GError *error;
+} AticonfigRequest;
+
 static void is_aticonfig_plugin_finalize(GObject *object);
 
 static void
@@ -98,28 +128,15 @@ is_aticonfig_plugin_get_property(GObject *object,
 static void
 is_aticonfig_plugin_init(IsATIConfigPlugin *self)
 {
-  GError *error = NULL;
   IsATIConfigPluginPrivate *priv =
     G_TYPE_INSTANCE_GET_PRIVATE(self, IS_TYPE_ATICONFIG_PLUGIN,
                                 IsATIConfigPluginPrivate);
 
   self->priv = priv;
-  priv->temperature_regex = g_regex_new(".*Sensor 0: Temperature - ([0-9|\\.]+) C",
-                                        0, 0, &error);
-  if (!priv->temperature_regex)
-  {
-    is_warning("aticonfig", "Error compiling regex to read sensor temperatures: %s",
-               error->message);
-    g_clear_error(&error);
-  }
-
-  priv->fanspeed_regex = g_regex_new(".*Fan Speed: ([0-9]+)%", 0, 0, &error);
-  if (!priv->fanspeed_regex)
-  {
-    is_warning("aticonfig", "Error compiling regex to read sensor fanspeeds: %s",
-               error->message);
-    g_clear_error(&error);
-  }
+  priv->pending = g_ptr_array_new();
+  priv->sampling = g_ptr_array_new();
+  priv->requests = g_ptr_array_new();
+  priv->cancellable = g_cancellable_new();
 }
 
 static void
@@ -128,40 +145,59 @@ is_aticonfig_plugin_finalize(GObject *object)
   IsATIConfigPlugin *plugin = IS_ATICONFIG_PLUGIN(object);
   IsATIConfigPluginPrivate *priv = plugin->priv;
 
-  if (priv->temperature_regex)
-  {
-    g_regex_unref(priv->temperature_regex);
-  }
-  if (priv->fanspeed_regex)
+  /* a run in flight holds a reference on us */
+  g_assert(!priv->n_running);
+  g_object_unref(priv->cancellable);
+  g_ptr_array_free(priv->requests, TRUE);
+  g_ptr_array_free(priv->sampling, TRUE);
+  g_ptr_array_free(priv->pending, TRUE);
+  if (priv->application)
   {
-    g_regex_unref(priv->fanspeed_regex);
+    g_object_unref(priv->application);
+    priv->application = NULL;
   }
   G_OBJECT_CLASS(is_aticonfig_plugin_parent_class)->finalize(object);
 }
 
 #define ATICONFIG_GPU_PREFIX ATICONFIG_PATH_PREFIX "/GPU"
 
-static gboolean aticonfig_get_temperature(IsATIConfigPlugin *self,
-    int gpu,
-    gdouble *result,
-    GError **error)
+/* finds the temperature of gpu in the output of aticonfig
+ * --od-gettemperature, which lists each adapter followed by its sensors */
+static gboolean
+parse_temperature(IsATIConfigPlugin *self,
+                  const gchar *output,
+                  gint gpu,
+                  gdouble *result,
+                  GError **error)
 {
-  gchar *command = NULL;
-  gchar *output = NULL;
-  GMatchInfo *match = NULL;
-  gchar *temperature = NULL;
-  gboolean ret;
+  IsATIConfigPluginClass *klass = IS_ATICONFIG_PLUGIN_GET_CLASS(self);
+  gchar **lines;
+  gint adapter = -1;
+  gboolean ret = FALSE;
+  guint i;
 
-  command = g_strdup_printf("aticonfig --od-gettemperature --adapter=%d", gpu);
-  ret = g_spawn_command_line_sync(command, &output, NULL, NULL, error);
-  if (!ret)
+  lines = g_strsplit(output, "\n", -1);
+  for (i = 0; lines[i] != NULL && !ret; i++)
   {
-    is_warning("aticonfig", "Error calling aticonfig to get temperature for GPU %d: %s",
-               gpu, (*error)->message);
-    goto out;
-  }
+    GMatchInfo *match = NULL;
 
-  ret = g_regex_match(self->priv->temperature_regex, output, 0, &match);
+    if (g_regex_match(klass->adapter_regex, lines[i], 0, &match))
+    {
+      gchar *idx = g_match_info_fetch(match, 1);
+      adapter = g_ascii_strtoll(idx, NULL, 10);
+      g_free(idx);
+    }
+    else if (adapter == gpu &&
+             g_regex_match(klass->temperature_regex, lines[i], 0, &match))
+    {
+      gchar *temperature = g_match_info_fetch(match, 1);
+      *result = g_strtod(temperature, NULL);
+      g_free(temperature);
+      ret = TRUE;
+    }
+    g_match_info_free(match);
+  }
+  g_strfreev(lines);
   if (!ret)
   {
     *error = g_error_new(g_quark_from_string("aticonfig-plugin-error-quark"),
@@ -169,40 +205,23 @@ static gboolean aticonfig_get_temperature(IsATIConfigPlugin *self,
                          /* first placeholder is sensor name */
                          _("Error reading temperature value for GPU %d"),
                          gpu);
-    goto out;
   }
-  temperature = g_match_info_fetch(match, 1);
-  *result = g_strtod(temperature, NULL);
-  g_free(temperature);
-
-out:
-  g_match_info_free(match);
-  g_free(output);
-  g_free(command);
   return ret;
 }
 
-static gboolean aticonfig_get_fanspeed(IsATIConfigPlugin *self,
-                                       int gpu,
-                                       gdouble *result,
-                                       GError **error)
+static gboolean
+parse_fanspeed(IsATIConfigPlugin *self,
+               const gchar *output,
+               gint gpu,
+               gdouble *result,
+               GError **error)
 {
-  gchar *command = NULL;
-  gchar *output = NULL;
   GMatchInfo *match = NULL;
   gchar *fanspeed = NULL;
   gboolean ret;
 
-  command = g_strdup_printf("aticonfig --pplib-cmd \"get fanspeed %d\"", gpu);
-  ret = g_spawn_command_line_sync(command, &output, NULL, NULL, error);
-  if (!ret)
-  {
-    is_warning("aticonfig", "Error calling aticonfig to get fanspeed for GPU %d: %s",
-               gpu, (*error)->message);
-    goto out;
-  }
-
-  ret = g_regex_match(self->priv->fanspeed_regex, output, 0, &match);
+  ret = g_regex_match(IS_ATICONFIG_PLUGIN_GET_CLASS(self)->fanspeed_regex,
+                      output, 0, &match);
   if (!ret)
   {
     *error = g_error_new(g_quark_from_string("aticonfig-plugin-error-quark"),
@@ -218,27 +237,113 @@ static gboolean aticonfig_get_fanspeed(IsATIConfigPlugin *self,
 
 out:
   g_match_info_free(match);
-  g_free(output);
-  g_free(command);
   return ret;
 }
 
+/* runs aticonfig with args and calls callback with its output without
+ * blocking - get the output with aticonfig_finish() */
+static gboolean
+aticonfig_spawn(IsATIConfigPlugin *self,
+                const gchar * const *args,
+                GAsyncReadyCallback callback,
+                gpointer user_data,
+                GError **error)
+{
+  GPtrArray *argv;
+  GSubprocess *subprocess;
+
+  argv = g_ptr_array_new();
+  g_ptr_array_add(argv, (gpointer)"aticonfig");
+  for (; *args; args++)
+  {
+    g_ptr_array_add(argv, (gpointer)*args);
+  }
+  g_ptr_array_add(argv, NULL);
+  subprocess = g_subprocess_newv((const gchar * const *)argv->pdata,
+                                 G_SUBPROCESS_FLAGS_STDOUT_PIPE |
+                                 G_SUBPROCESS_FLAGS_STDERR_SILENCE,
+                                 error);
+  g_ptr_array_free(argv, TRUE);
+  if (subprocess)
+  {
+    /* the operation keeps subprocess alive until it completes */
+    g_subprocess_communicate_utf8_async(subprocess, NULL,
+                                        self->priv->cancellable,
+                                        callback, user_data);
+    g_object_unref(subprocess);
+  }
+  return subprocess != NULL;
+}
+
+static gchar *
+aticonfig_finish(GObject *source,
+                 GAsyncResult *result,
+                 GError **error)
+{
+  gchar *output = NULL;
+
+  if (!g_subprocess_communicate_utf8_finish(G_SUBPROCESS(source), result,
+                                            &output, NULL, error))
+  {
+    return NULL;
+  }
+  return output ? output : g_strdup("");
+}
+
 static void
-update_sensor_value(IsSensor *sensor,
-                    IsATIConfigPlugin *self)
+aticonfig_binding_free(AticonfigBinding *binding,
+                       GClosure *closure)
 {
-  const gchar *path;
-  gint gpu;
+  g_slice_free(AticonfigBinding, binding);
+}
+
+static void
+aticonfig_request_free(AticonfigRequest *request)
+{
+  g_clear_error(&request->error);
+  g_free(request->output);
+  g_slice_free(AticonfigRequest, request);
+}
+
+static AticonfigRequest *
+find_request(IsATIConfigPlugin *self,
+             gint gpu)
+{
+  GPtrArray *requests = self->priv->requests;
+  guint i;
+
+  for (i = 0; i < requests->len; i++)
+  {
+    AticonfigRequest *request = g_ptr_array_index(requests, i);
+    if (request->gpu == gpu)
+    {
+      return request;
+    }
+  }
+  return NULL;
+}
+
+static void
+publish_binding(IsATIConfigPlugin *self,
+                AticonfigBinding *binding)
+{
+  AticonfigRequest *request;
+  IsSensor *sensor = binding->sensor;
   gdouble value = 0.0;
-  gboolean ret = FALSE;
   GError *error = NULL;
+  gboolean ret;
 
-  path = is_sensor_get_path(sensor);
-  gpu = g_ascii_strtoll(path + strlen(ATICONFIG_GPU_PREFIX), NULL, 10);
-
-  if (IS_IS_TEMPERATURE_SENSOR(sensor))
+  request = find_request(self, binding->temperature ? -1 : binding->gpu);
+  g_assert(request);
+  if (request->error)
   {
-    ret = aticonfig_get_temperature(self, gpu, &value, &error);
+    error = g_error_copy(request->error);
+    goto out;
+  }
+  if (binding->temperature)
+  {
+    ret = parse_temperature(self, request->output, binding->gpu, &value,
+                            &error);
     if (ret)
     {
       is_temperature_sensor_set_celsius_value(IS_TEMPERATURE_SENSOR(sensor),
@@ -248,12 +353,15 @@ update_sensor_value(IsSensor *sensor,
   else
   {
     /* is a fan sensor */
-    ret = aticonfig_get_fanspeed(self, gpu, &value, &error);
+    ret = parse_fanspeed(self, request->output, binding->gpu, &value,
+                         &error);
     if (ret)
     {
       is_sensor_set_value(sensor, value);
     }
   }
+
+out:
   /* set any error which may have occurred */
   if (error)
   {
@@ -266,160 +374,419 @@ update_sensor_value(IsSensor *sensor,
   }
 }
 
+/* called once every aticonfig process of a run has completed */
 static void
-is_aticonfig_plugin_activate(PeasActivatable *activatable)
+publish_values(IsATIConfigPlugin *self)
 {
-  IsATIConfigPlugin *self = IS_ATICONFIG_PLUGIN(activatable);
-  IsManager *manager;
-  gchar *output = NULL;
-  GError *error = NULL;
-  GRegex *regex = NULL;
-  GMatchInfo *match = NULL;
-  gboolean ret;
+  IsATIConfigPluginPrivate *priv = self->priv;
+  gboolean cancelled;
+  guint i;
+
+  cancelled = g_cancellable_is_cancelled(priv->cancellable);
+  for (i = 0; i < priv->sampling->len; i++)
+  {
+    AticonfigBinding *binding = g_ptr_array_index(priv->sampling, i);
+    if (!cancelled)
+    {
+      is_sensor_freeze_changed(binding->sensor);
+      publish_binding(self, binding);
+      is_sensor_thaw_changed(binding->sensor);
+    }
+    /* drop reference taken when queued */
+    g_object_unref(binding->sensor);
+  }
+  g_ptr_array_set_size(priv->sampling, 0);
+  g_ptr_array_foreach(priv->requests, (GFunc)aticonfig_request_free, NULL);
+  g_ptr_array_set_size(priv->requests, 0);
+}
 
-  manager = is_application_get_manager(self->priv->application);
+static void
+aticonfig_done(GObject *source,
+               GAsyncResult *result,
+               AticonfigRequest *request)
+{
+  IsATIConfigPlugin *self = request->plugin;
+  IsATIConfigPluginPrivate *priv = self->priv;
 
-  is_debug("aticonfig", "Checking for hybrid system with integrated GPU active");
-  ret = g_spawn_command_line_sync("aticonfig --pxl",
-                                  &output, NULL, NULL, &error);
+  request->output = aticonfig_finish(source, result, &request->error);
+  if (!request->output &&
+      !g_error_matches(request->error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+  {
+    is_warning("aticonfig", "Error calling aticonfig to get sensor values: %s",
+               request->error->message);
+  }
+  if (--priv->n_running == 0)
+  {
+    publish_values(self);
+  }
+  /* drop reference taken when spawned */
+  g_object_unref(self);
+}
+
+static void
+spawn_aticonfig(IsATIConfigPlugin *self,
+                gint gpu)
+{
+  IsATIConfigPluginPrivate *priv = self->priv;
+  AticonfigRequest *request;
+  gchar *cmd = NULL;
+  gboolean ret;
+
+  request = g_slice_new0(AticonfigRequest);
+  request->plugin = self;
+  request->gpu = gpu;
+  g_ptr_array_add(priv->requests, request);
+  if (gpu < 0)
+  {
+    const gchar *args[] = { "--od-gettemperature", "--adapter=all", NULL };
+    ret = aticonfig_spawn(self, args, (GAsyncReadyCallback)aticonfig_done,
+                          request, &request->error);
+  }
+  else
+  {
+    const gchar *args[] = { "--pplib-cmd", NULL, NULL };
+    args[1] = cmd = g_strdup_printf("get fanspeed %d", gpu);
+    ret = aticonfig_spawn(self, args, (GAsyncReadyCallback)aticonfig_done,
+                          request, &request->error);
+    g_free(cmd);
+  }
   if (!ret)
   {
-    is_warning("aticonfig", "Error calling aticonfig to detect if running on a hybrid system with integrated GPU active: %s",
-               error->message);
-    g_error_free(error);
+    is_warning("aticonfig", "Error calling aticonfig to get sensor values: %s",
+               request->error->message);
     goto out;
   }
-  is_debug("aticonfig", "Trying to match output to see if integrated GPU is active: '%s'",
-           output);
+  priv->n_running++;
+  /* keep us alive until it completes */
+  g_object_ref(self);
 
-  regex = g_regex_new("^.*integrated gpu is active.*$",
-                      G_REGEX_CASELESS | G_REGEX_MULTILINE, 0, &error);
-  if (!regex)
+out:
+  return;
+}
+
+static void
+update_sensor_value(IsSensor *sensor,
+                    AticonfigBinding *binding)
+{
+  /* just queue - all due sensors are read together from update_values() */
+  if (!binding->queued)
   {
-    is_warning("aticonfig", "Error compiling regex to detect if running on a hybrid system with integrated GPU active: %s",
-               error->message);
-    g_error_free(error);
-    goto out;
+    binding->queued = TRUE;
+    /* keep sensor alive until its value is published */
+    g_object_ref(sensor);
+    g_ptr_array_add(binding->plugin->priv->pending, binding);
   }
+}
 
-  ret = g_regex_match(regex, output, 0, NULL);
-  if (ret)
+static void
+update_values(IsApplication *application,
+              GPtrArray *sensors,
+              IsATIConfigPlugin *self)
+{
+  IsATIConfigPluginPrivate *priv = self->priv;
+  GPtrArray *sampling;
+  gboolean temperature = FALSE;
+  guint i;
+
+  /* if the last run is still going then whatever is due now just waits
+   * for the next tick */
+  if (priv->n_running > 0 || priv->pending->len == 0)
   {
-    is_warning("aticonfig", "Running on a hybrid system with integrated active - bailing so we don't hit bug LP #1016896");
-    goto out;
+    return;
   }
+  sampling = priv->sampling;
+  priv->sampling = priv->pending;
+  priv->pending = sampling;
 
-  is_debug("aticonfig", "This does not appear to be a hybrid system with integrated GPU active - we're good to go!");
+  /* a single process reads the temperature of every adapter, whereas
+   * fanspeed needs one for each adapter */
+  for (i = 0; i < priv->sampling->len; i++)
+  {
+    AticonfigBinding *binding = g_ptr_array_index(priv->sampling, i);
+    binding->queued = FALSE;
+    if (binding->temperature)
+    {
+      temperature = TRUE;
+    }
+    else if (!find_request(self, binding->gpu))
+    {
+      spawn_aticonfig(self, binding->gpu);
+    }
+  }
+  if (temperature)
+  {
+    spawn_aticonfig(self, -1);
+  }
+  /* everything failed to spawn */
+  if (priv->n_running == 0)
+  {
+    publish_values(self);
+  }
+}
 
-  /* search for sensors and add them to manager */
-  is_debug("aticonfig", "searching for sensors");
+static void
+add_sensor(IsATIConfigPlugin *self,
+           gint gpu,
+           const gchar *name,
+           gboolean temperature)
+{
+  AticonfigBinding *binding;
+  IsSensor *sensor;
+  gchar *path;
+
+  if (temperature)
+  {
+    path = g_strdup_printf("%s%d%s", ATICONFIG_GPU_PREFIX, gpu, _("Temperature"));
+    sensor = is_temperature_sensor_new(path);
+    is_sensor_set_icon(sensor, IS_STOCK_GPU);
+  }
+  else
+  {
+    path = g_strdup_printf("%s%d%s", ATICONFIG_GPU_PREFIX, gpu, _("Fan"));
+    sensor = is_sensor_new(path);
+    /* fan sensors are given as a percentage from 0 to 100 */
+    is_sensor_set_units(sensor, "%");
+    is_sensor_set_low_value(sensor, 0.0);
+    is_sensor_set_high_value(sensor, 100.0);
+    is_sensor_set_digits(sensor, 0);
+    is_sensor_set_icon(sensor, IS_STOCK_FAN);
+  }
+  is_sensor_set_label(sensor, name);
+
+  binding = g_slice_new0(AticonfigBinding);
+  binding->plugin = self;
+  binding->sensor = sensor;
+  binding->gpu = gpu;
+  binding->temperature = temperature;
+  /* binding is freed along with the handler */
+  g_signal_connect_data(sensor, "update-value",
+                        G_CALLBACK(update_sensor_value),
+                        binding, (GClosureNotify)aticonfig_binding_free, 0);
+  is_manager_add_sensor(is_application_get_manager(self->priv->application),
+                        sensor);
+  g_object_unref(sensor);
+  g_free(path);
+}
+
+/* probes whether a single adapter can read temperature or fanspeed */
+typedef struct
+{
+  IsATIConfigPlugin *plugin;
+  gint gpu;
+  gchar *name;
+  gboolean temperature;
+} AticonfigProbe;
+
+static void
+aticonfig_probe_free(AticonfigProbe *probe)
+{
+  g_object_unref(probe->plugin);
+  g_free(probe->name);
+  g_slice_free(AticonfigProbe, probe);
+}
+
+static void
+probe_done(GObject *source,
+           GAsyncResult *result,
+           AticonfigProbe *probe)
+{
+  IsATIConfigPlugin *self = probe->plugin;
+  const gchar *what = probe->temperature ? "temperature" : "fanspeed";
+  gchar *output;
+  gdouble value;
+  GError *error = NULL;
+  gboolean ret;
 
-  /* call aticonfig with --list-adapters to get available adapters,
-   * then test if each can do temperature and fan speed - if so add
-   * appropriate sensors */
-  ret = g_spawn_command_line_sync("aticonfig --list-adapters",
-                                  &output, NULL, NULL, &error);
+  output = aticonfig_finish(source, result, &error);
+  if (!output)
+  {
+    if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    {
+      is_warning("aticonfig", "Error calling aticonfig to get %s for adapter %d: %s",
+                 what, probe->gpu, error->message);
+    }
+    goto out;
+  }
+  ret = (probe->temperature ?
+         parse_temperature(self, output, probe->gpu, &value, &error) :
+         parse_fanspeed(self, output, probe->gpu, &value, &error));
   if (!ret)
   {
-    is_warning("aticonfig", "Error calling aticonfig to detect available sensors: %s",
-               error->message);
-    g_error_free(error);
+    is_warning("aticonfig", "Error getting %s for adapter %d: %s",
+               what, probe->gpu, error->message);
     goto out;
   }
+  add_sensor(self, probe->gpu, probe->name, probe->temperature);
 
-  regex = g_regex_new("^.*([0-9]+)\\. ([0-9][0-9]:[0-9][0-9]\\.[0-9])\\s*(.*?)\\s*$",
-                      G_REGEX_MULTILINE, 0, &error);
-  if (!regex)
+out:
+  g_clear_error(&error);
+  g_free(output);
+  aticonfig_probe_free(probe);
+}
+
+static void
+probe_adapter(IsATIConfigPlugin *self,
+              gint gpu,
+              const gchar *name,
+              gboolean temperature)
+{
+  AticonfigProbe *probe;
+  const gchar *args[] = { NULL, NULL, NULL };
+  gchar *arg;
+  GError *error = NULL;
+
+  probe = g_slice_new0(AticonfigProbe);
+  probe->plugin = g_object_ref(self);
+  probe->gpu = gpu;
+  probe->name = g_strdup(name);
+  probe->temperature = temperature;
+  if (temperature)
   {
-    is_warning("aticonfig", "Error compiling regex to detect listed sensors: %s",
-               error->message);
+    args[0] = "--od-gettemperature";
+    args[1] = arg = g_strdup_printf("--adapter=%d", gpu);
+  }
+  else
+  {
+    args[0] = "--pplib-cmd";
+    args[1] = arg = g_strdup_printf("get fanspeed %d", gpu);
+  }
+  if (!aticonfig_spawn(self, args, (GAsyncReadyCallback)probe_done, probe,
+                       &error))
+  {
+    is_warning("aticonfig", "Error calling aticonfig to probe adapter %d: %s",
+               gpu, error->message);
     g_error_free(error);
+    aticonfig_probe_free(probe);
+  }
+  g_free(arg);
+}
+
+static void
+list_adapters_done(GObject *source,
+                   GAsyncResult *result,
+                   IsATIConfigPlugin *self)
+{
+  gchar *output;
+  GMatchInfo *match = NULL;
+  GError *error = NULL;
+
+  output = aticonfig_finish(source, result, &error);
+  if (!output)
+  {
+    if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    {
+      is_warning("aticonfig", "Error calling aticonfig to detect available sensors: %s",
+                 error->message);
+    }
     goto out;
   }
 
-  ret = g_regex_match(regex, output, 0, &match);
-  if (!ret)
+  if (!g_regex_match(IS_ATICONFIG_PLUGIN_GET_CLASS(self)->adapters_regex,
+                     output, 0, &match))
   {
     is_warning("aticonfig", "No sensors found in aticonfig output: %s", output);
     goto out;
   }
+  /* test if each adapter can do temperature and fan speed - sensors are
+   * added as each probe completes */
   while (g_match_info_matches(match))
   {
     gint i;
-    gchar *idx, *pci, *name;
-    gdouble value;
-    gchar *path;
-    IsSensor *sensor;
+    gchar *idx, *name;
 
     idx = g_match_info_fetch(match, 1);
-    pci = g_match_info_fetch(match, 2);
     name = g_match_info_fetch(match, 3);
-
     i = g_ascii_strtoull(idx, NULL, 10);
-    /* we have an adapter - see if we can get its temperature and
-       fanspeed */
-    ret = aticonfig_get_temperature(self, i, &value, &error);
-    if (!ret)
-    {
-      is_warning("aticonfig", "Error getting temperature for adapter %d: %s",
-                 i, error->message);
-      g_clear_error(&error);
-    }
-    else
-    {
-      path = g_strdup_printf("%s%d%s", ATICONFIG_GPU_PREFIX, i, _("Temperature"));
-      sensor = is_temperature_sensor_new(path);
-      is_sensor_set_label(sensor, name);
-      is_sensor_set_icon(sensor, IS_STOCK_GPU);
-      g_signal_connect(sensor, "update-value",
-                       G_CALLBACK(update_sensor_value),
-                       self);
-      is_manager_add_sensor(manager, sensor);
-      g_object_unref(sensor);
-      g_free(path);
-    }
-
-    ret = aticonfig_get_fanspeed(self, i, &value, &error);
-    if (!ret)
-    {
-      is_warning("aticonfig", "Error getting fanpeed for adapter %d: %s",
-                 i, error->message);
-      g_clear_error(&error);
-    }
-    else
-    {
-      path = g_strdup_printf("%s%d%s", ATICONFIG_GPU_PREFIX, i, _("Fan"));
-      sensor = is_sensor_new(path);
-      is_sensor_set_label(sensor, name);
-      /* fan sensors are given as a percentage from 0 to 100 */
-      is_sensor_set_units(sensor, "%");
-      is_sensor_set_low_value(sensor, 0.0);
-      is_sensor_set_high_value(sensor, 100.0);
-      is_sensor_set_digits(sensor, 0);
-      is_sensor_set_icon(sensor, IS_STOCK_FAN);
-      g_signal_connect(sensor, "update-value",
-                       G_CALLBACK(update_sensor_value),
-                       self);
-      is_manager_add_sensor(manager, sensor);
-      g_object_unref(sensor);
-      g_free(path);
-    }
-
+    probe_adapter(self, i, name, TRUE);
+    probe_adapter(self, i, name, FALSE);
     g_free(idx);
-    g_free(pci);
     g_free(name);
 
-    g_match_info_next(match, &error);
+    g_match_info_next(match, NULL);
   }
 
 out:
   g_match_info_free(match);
-  if (regex)
+  g_clear_error(&error);
+  g_free(output);
+  g_object_unref(self);
+}
+
+static void
+pxl_done(GObject *source,
+         GAsyncResult *result,
+         IsATIConfigPlugin *self)
+{
+  const gchar *args[] = { "--list-adapters", NULL };
+  gchar *output;
+  GError *error = NULL;
+
+  output = aticonfig_finish(source, result, &error);
+  if (!output)
+  {
+    if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    {
+      is_warning("aticonfig", "Error calling aticonfig to detect if running on a hybrid system with integrated GPU active: %s",
+                 error->message);
+    }
+    goto out;
+  }
+  is_debug("aticonfig", "Trying to match output to see if integrated GPU is active: '%s'",
+           output);
+  if (g_regex_match(IS_ATICONFIG_PLUGIN_GET_CLASS(self)->hybrid_regex,
+                    output, 0, NULL))
+  {
+    is_warning("aticonfig", "Running on a hybrid system with integrated active - bailing so we don't hit bug LP #1016896");
+    goto out;
+  }
+
+  is_debug("aticonfig", "This does not appear to be a hybrid system with integrated GPU active - we're good to go!");
+
+  /* search for sensors and add them to manager */
+  is_debug("aticonfig", "searching for sensors");
+  if (!aticonfig_spawn(self, args, (GAsyncReadyCallback)list_adapters_done,
+                       g_object_ref(self), &error))
   {
-    g_regex_unref(regex);
+    is_warning("aticonfig", "Error calling aticonfig to detect available sensors: %s",
+               error->message);
+    g_object_unref(self);
   }
+
+out:
+  g_clear_error(&error);
   g_free(output);
-  return;
+  g_object_unref(self);
+}
+
+static void
+is_aticonfig_plugin_activate(PeasActivatable *activatable)
+{
+  IsATIConfigPlugin *self = IS_ATICONFIG_PLUGIN(activatable);
+  IsATIConfigPluginPrivate *priv = self->priv;
+  const gchar *args[] = { "--pxl", NULL };
+  GError *error = NULL;
+
+  /* may have been cancelled by a previous deactivation */
+  if (g_cancellable_is_cancelled(priv->cancellable))
+  {
+    g_object_unref(priv->cancellable);
+    priv->cancellable = g_cancellable_new();
+  }
+  g_signal_connect(priv->application,
+                   "update-values::" ATICONFIG_PATH_PREFIX,
+                   G_CALLBACK(update_values), self);
+
+  /* detection is done asynchronously so a slow (or missing) aticonfig
+   * doesn't hold up startup - each step holds a reference on us */
+  is_debug("aticonfig", "Checking for hybrid system with integrated GPU active");
+  if (!aticonfig_spawn(self, args, (GAsyncReadyCallback)pxl_done,
+                       g_object_ref(self), &error))
+  {
+    is_warning("aticonfig", "Error calling aticonfig to detect if running on a hybrid system with integrated GPU active: %s",
+               error->message);
+    g_error_free(error);
+    g_object_unref(self);
+  }
 }
 
 static void
@@ -428,11 +795,37 @@ is_aticonfig_plugin_deactivate(PeasActivatable *activatable)
   IsATIConfigPlugin *plugin = IS_ATICONFIG_PLUGIN(activatable);
   IsATIConfigPluginPrivate *priv = plugin->priv;
   IsManager *manager;
-
+  guint i;
+
+  g_signal_handlers_disconnect_by_func(priv->application, update_values,
+                                       plugin);
+  /* stop any run in flight - its sensors are released as it completes -
+   * and drop anything still waiting */
+  g_cancellable_cancel(priv->cancellable);
+  for (i = 0; i < priv->pending->len; i++)
+  {
+    AticonfigBinding *binding = g_ptr_array_index(priv->pending, i);
+    binding->queued = FALSE;
+    g_object_unref(binding->sensor);
+  }
+  g_ptr_array_set_size(priv->pending, 0);
   manager = is_application_get_manager(priv->application);
   is_manager_remove_paths_with_prefix(manager, ATICONFIG_PATH_PREFIX);
 }
 
+/* all regexes are constant so failing to compile any is a bug */
+static GRegex *
+compile_regex(const gchar *pattern,
+              GRegexCompileFlags flags)
+{
+  GRegex *regex;
+  GError *error = NULL;
+
+  regex = g_regex_new(pattern, flags | G_REGEX_OPTIMIZE, 0, &error);
+  g_assert_no_error(error);
+  return regex;
+}
+
 static void
 is_aticonfig_plugin_class_init(IsATIConfigPluginClass *klass)
 {
@@ -445,6 +838,15 @@ is_aticonfig_plugin_class_init(IsATIConfigPluginClass *klass)
   gobject_class->finalize = is_aticonfig_plugin_finalize;
 
   g_object_class_override_property(gobject_class, PROP_OBJECT, "object");
+
+  klass->hybrid_regex = compile_regex("^.*integrated gpu is active.*$",
+                                      G_REGEX_CASELESS | G_REGEX_MULTILINE);
+  klass->adapters_regex = compile_regex("^.*([0-9]+)\\. ([0-9][0-9]:[0-9][0-9]\\.[0-9])\\s*(.*?)\\s*$",
+                                        G_REGEX_MULTILINE);
+  klass->adapter_regex = compile_regex("^\\s*Adapter ([0-9]+)", 0);
+  klass->temperature_regex = compile_regex(".*Sensor 0: Temperature - ([0-9|\\.]+) C",
+                                           0);
+  klass->fanspeed_regex = compile_regex(".*Fan Speed: ([0-9]+)%", 0);
 }
 
 static void
@@ -457,7 +859,11 @@ peas_activatable_iface_init(PeasActivatableInterface *iface)
 static void
 is_aticonfig_plugin_class_finalize(IsATIConfigPluginClass *klass)
 {
-  /* nothing to do */
+  g_regex_unref(klass->fanspeed_regex);
+  g_regex_unref(klass->temperature_regex);
+  g_regex_unref(klass->adapter_regex);
+  g_regex_unref(klass->adapters_regex);
+  g_regex_unref(klass->hybrid_regex);
 }
 
 G_MODULE_EXPORT void
@@ -51,6 +51,13 @@ typedef struct _IsATIConfigPluginPrivate IsATIConfigPluginPrivate;
 struct _IsATIConfigPluginClass
 {
   PeasExtensionBaseClass parent_class;
+  /* used to parse the output of aticonfig - compiled once for all
+   * instances */
+  GRegex *hybrid_regex;
+  GRegex *adapters_regex;
+  GRegex *adapter_regex;
+  GRegex *temperature_regex;
+  GRegex *fanspeed_regex;
 };
 
 struct _IsATIConfigPlugin
@@ -48,6 +48,8 @@ struct _IsDBusPluginPrivate
   GDBusObjectManagerServer *sensors_object_manager;
   GDBusObjectManagerServer *search_object_manager;
   IsOrgGnomeShellSearchProvider2 *skeleton;
+  /* exported IsActiveSensor for each enabled IsSensor */
+  GHashTable *active_sensors;
 };
 
 static void is_dbus_plugin_finalize(GObject *object);
@@ -99,6 +101,8 @@ is_dbus_plugin_init(IsDBusPlugin *self)
     G_TYPE_INSTANCE_GET_PRIVATE(self, IS_TYPE_DBUS_PLUGIN,
                                 IsDBusPluginPrivate);
   self->priv = priv;
+  priv->active_sensors = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                               NULL, g_object_unref);
 }
 
 static void
@@ -107,7 +111,7 @@ is_dbus_plugin_finalize(GObject *object)
   IsDBusPlugin *self = (IsDBusPlugin *)object;
   IsDBusPluginPrivate *priv = self->priv;
 
-
+  g_hash_table_destroy(priv->active_sensors);
   if (priv->application)
   {
     g_object_unref(priv->application);
@@ -117,39 +121,38 @@ is_dbus_plugin_finalize(GObject *object)
 }
 
 static void
-sensor_property_changed(IsSensor *sensor,
-                        GParamSpec *pspec,
-                        gpointer data)
+sensor_changed(IsSensor *sensor,
+               guint changed,
+               gpointer data)
 {
-  const gchar *name = g_param_spec_get_name(pspec);
   IsActiveSensor *active_sensor = IS_ACTIVE_SENSOR(data);
 
-  if (!g_strcmp0(name, "value"))
+  if (changed & IS_SENSOR_CHANGED_VALUE)
   {
     is_active_sensor_set_value(active_sensor,
                                is_sensor_get_value(sensor));
   }
-  else if (!g_strcmp0(name, "label"))
+  if (changed & IS_SENSOR_CHANGED_LABEL)
   {
     is_active_sensor_set_label(active_sensor,
                                is_sensor_get_label(sensor));
   }
-  else if (!g_strcmp0(name, "units"))
+  if (changed & IS_SENSOR_CHANGED_UNITS)
   {
     is_active_sensor_set_units(active_sensor,
                                is_sensor_get_units(sensor));
   }
-  else if (!g_strcmp0(name, "icon-path"))
+  if (changed & IS_SENSOR_CHANGED_ICON_PATH)
   {
     is_active_sensor_set_icon_path(active_sensor,
                                    is_sensor_get_icon_path(sensor));
   }
-  else if (!g_strcmp0(name, "digits"))
+  if (changed & IS_SENSOR_CHANGED_DIGITS)
   {
     is_active_sensor_set_digits(active_sensor,
                                 is_sensor_get_digits(sensor));
   }
-  else if (!g_strcmp0(name, "error"))
+  if (changed & IS_SENSOR_CHANGED_ERROR)
   {
     is_active_sensor_set_error(active_sensor,
                                is_sensor_get_error(sensor));
@@ -182,19 +185,41 @@ sensor_position_changed(IsManager *manager,
                         gint i,
                         IsDBusPlugin *self)
 {
-  IsDBusPluginPrivate *priv;
-  IsObjectSkeleton *object;
   IsActiveSensor *active_sensor;
-  gchar *path;
 
-  priv = self->priv;
-  path = dbus_sensor_object_path(sensor);
-  object = IS_OBJECT_SKELETON(g_dbus_object_manager_get_object(G_DBUS_OBJECT_MANAGER(priv->sensors_object_manager),
-                                                               path));
-  g_object_get(object, "active-sensor", &active_sensor, NULL);
-  is_active_sensor_set_index(active_sensor, i);
-  g_object_unref(object);
-  g_free(path);
+  active_sensor = g_hash_table_lookup(self->priv->active_sensors, sensor);
+  if (active_sensor)
+  {
+    is_active_sensor_set_index(active_sensor, i);
+  }
+}
+
+typedef struct
+{
+  IsDBusPlugin *self;
+  gint i;
+} PositionsData;
+
+static void
+update_sensor_position(IsSensor *sensor,
+                       PositionsData *data)
+{
+  sensor_position_changed(NULL, sensor, data->i++, data->self);
+}
+
+static void
+sensors_positions_changed(IsManager *manager,
+                          IsDBusPlugin *self)
+{
+  PositionsData data;
+
+  /* the skeleton only emits PropertiesChanged for those whose index
+   * actually changed */
+  data.self = self;
+  data.i = 0;
+  is_manager_foreach_enabled_sensor(manager,
+                                    (GFunc)update_sensor_position,
+                                    &data);
 }
 
 static void
@@ -229,10 +254,11 @@ sensor_enabled(IsManager *manager,
   is_active_sensor_set_index(active_sensor, i);
   is_active_sensor_set_icon_path(active_sensor, is_sensor_get_icon_path(sensor));
 
-  g_signal_connect(sensor, "notify",
-                   G_CALLBACK(sensor_property_changed), active_sensor);
+  g_signal_connect(sensor, "changed",
+                   G_CALLBACK(sensor_changed), active_sensor);
   is_object_skeleton_set_active_sensor(object, active_sensor);
-  g_object_unref(active_sensor);
+  /* takes our reference to active_sensor */
+  g_hash_table_insert(priv->active_sensors, sensor, active_sensor);
 
   /* Export the object (@manager takes its own reference to
    * @object) */
@@ -247,17 +273,18 @@ sensor_disabled(IsManager *manager,
                 IsDBusPlugin *self)
 {
   IsDBusPluginPrivate *priv;
-  IsObjectSkeleton *object;
   IsActiveSensor *active_sensor;
   gchar *path;
 
   priv = self->priv;
+  active_sensor = g_hash_table_lookup(priv->active_sensors, sensor);
+  if (!active_sensor)
+  {
+    return;
+  }
+  g_signal_handlers_disconnect_by_func(sensor, sensor_changed, active_sensor);
+  g_hash_table_remove(priv->active_sensors, sensor);
   path = dbus_sensor_object_path(sensor);
-  object = IS_OBJECT_SKELETON(g_dbus_object_manager_get_object(G_DBUS_OBJECT_MANAGER(priv->sensors_object_manager),
-                                                               path));
-  g_object_get(object, "active-sensor", &active_sensor, NULL);
-  g_object_unref(object);
-  g_signal_handlers_disconnect_by_func(sensor, sensor_property_changed, active_sensor);
   g_dbus_object_manager_server_unexport(priv->sensors_object_manager,
                                         path);
   g_free(path);
@@ -315,38 +342,45 @@ static const GDBusInterfaceVTable interface_vtable =
   NULL,
 };
 
+typedef struct
+{
+  GVariantBuilder *builder;
+  gchar **terms;
+} ResultSetData;
+
+static void
+add_sensor_to_result_set(IsSensor *sensor,
+                         ResultSetData *data)
+{
+  const gchar *label = is_sensor_get_label(sensor);
+  int i;
+
+  for (i = 0; data->terms[i] != NULL; i++)
+  {
+    if (g_str_match_string(data->terms[i], label, TRUE) ||
+        g_str_match_string(data->terms[i], "sensors", TRUE))
+    {
+      is_debug("dbus", "matched term %s against label %s", data->terms[i], label);
+      g_variant_builder_add(data->builder, "s", is_sensor_get_path(sensor));
+    }
+  }
+}
+
 static GVariant *
 get_result_set(IsDBusPlugin *self,
                gchar **terms)
 {
   GVariantBuilder builder;
-  GSList *sensors, *_list;
+  ResultSetData data;
   IsManager *manager;
 
   g_variant_builder_init(&builder, G_VARIANT_TYPE ("as"));
   manager = is_application_get_manager(self->priv->application);
-  sensors = is_manager_get_enabled_sensors_list(manager);
-
-  for (_list = sensors;
-       _list != NULL;
-       _list = _list->next)
-  {
-    int i;
-    IsSensor *sensor = IS_SENSOR(_list->data);
-    const gchar *label = is_sensor_get_label(sensor);
-
-    for (i = 0; terms[i] != NULL; i++)
-    {
-      if (g_str_match_string(terms[i], label, TRUE) ||
-          g_str_match_string(terms[i], "sensors", TRUE))
-      {
-        is_debug("dbus", "matched term %s against label %s", terms[i], label);
-        g_variant_builder_add(&builder, "s", is_sensor_get_path(sensor));
-      }
-    }
-    g_object_unref(sensor);
-  }
-  g_slist_free(sensors);
+  data.builder = &builder;
+  data.terms = terms;
+  is_manager_foreach_enabled_sensor(manager,
+                                    (GFunc)add_sensor_to_result_set,
+                                    &data);
 
   return g_variant_new("(as)", &builder);
 }
@@ -548,6 +582,8 @@ on_bus_acquired(GDBusConnection *connection,
                    G_CALLBACK(sensor_disabled), self);
   g_signal_connect(manager, "sensor-position-changed",
                    G_CALLBACK(sensor_position_changed), self);
+  g_signal_connect(manager, "positions-changed",
+                   G_CALLBACK(sensors_positions_changed), self);
   /* Export all objects */
   g_dbus_object_manager_server_set_connection(priv->sensors_object_manager, connection);
 }
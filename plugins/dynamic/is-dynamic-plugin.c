@@ -227,6 +227,27 @@ exit:
   return;
 }
 
+static void
+on_sensor_changed(IsSensor *sensor,
+                  guint changed,
+                  gpointer user_data)
+{
+  if (changed & IS_SENSOR_CHANGED_VALUE)
+  {
+    on_sensor_value_notify(sensor, NULL, user_data);
+  }
+}
+
+static void
+rescan_sensor(IsSensor *sensor,
+              gpointer user_data)
+{
+  if (IS_IS_TEMPERATURE_SENSOR(sensor))
+  {
+    on_sensor_value_notify(sensor, NULL, user_data);
+  }
+}
+
 static void
 on_sensor_enabled(IsManager *manager,
                   IsSensor *sensor,
@@ -240,8 +261,8 @@ on_sensor_enabled(IsManager *manager,
   {
     is_debug("dynamic", "sensor enabled: %s", is_sensor_get_label(sensor));
     on_sensor_value_notify(sensor, NULL, self);
-    g_signal_connect(sensor, "notify::value",
-                     G_CALLBACK(on_sensor_value_notify), self);
+    g_signal_connect(sensor, "changed",
+                     G_CALLBACK(on_sensor_changed), self);
   }
 }
 
@@ -258,14 +279,12 @@ on_sensor_disabled(IsManager *manager,
   {
     is_debug("dynamic", "sensor disabled: %s", is_sensor_get_label(sensor));
     g_signal_handlers_disconnect_by_func(sensor,
-                                         G_CALLBACK(on_sensor_value_notify),
+                                         G_CALLBACK(on_sensor_changed),
                                          self);
     if (priv->max == sensor)
     {
       // get all sensors and find the one with the maximum rate and switch to
       // this
-      GSList *sensors, *_list;
-
       priv->max = NULL;
       priv->max_rate = 0.0;
 
@@ -275,16 +294,9 @@ on_sensor_disabled(IsManager *manager,
       is_sensor_set_units(priv->sensor, "");
       is_sensor_set_digits(priv->sensor, 1);
 
-      sensors = is_manager_get_enabled_sensors_list(manager);
-      for (_list = sensors;
-           _list != NULL;
-           _list = _list->next)
-      {
-        if (IS_IS_TEMPERATURE_SENSOR(_list->data))
-        {
-          on_sensor_value_notify(IS_SENSOR(_list->data), NULL, self);
-        }
-      }
+      is_manager_foreach_enabled_sensor(manager,
+                                        (GFunc)rescan_sensor,
+                                        self);
     }
 
   }
@@ -0,0 +1,510 @@
+/*
+ * Copyright (C) 2011-2019 Alex Murray <murray.alex@gmail.com>
+ *
+ * indicator-sensors is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * indicator-sensors is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with indicator-sensors.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "is-hwmon-plugin.h"
+#include <errno.h>
+#include <string.h>
+#include <indicator-sensors/is-temperature-sensor.h>
+#include <indicator-sensors/is-fan-sensor.h>
+#include <indicator-sensors/is-application.h>
+#include <indicator-sensors/is-sysfs.h>
+#include <indicator-sensors/is-log.h>
+#include <glib/gi18n.h>
+
+#define HWMON_PATH_PREFIX "hwmon"
+#define HWMON_CLASS_DIR "/sys/class/hwmon"
+
+static void peas_activatable_iface_init(PeasActivatableInterface *iface);
+
+G_DEFINE_DYNAMIC_TYPE_EXTENDED(IsHwmonPlugin,
+                               is_hwmon_plugin,
+                               PEAS_TYPE_EXTENSION_BASE,
+                               0,
+                               G_IMPLEMENT_INTERFACE_DYNAMIC(PEAS_TYPE_ACTIVATABLE,
+                                   peas_activatable_iface_init));
+
+enum
+{
+  PROP_OBJECT = 1,
+};
+
+struct _IsHwmonPluginPrivate
+{
+  IsApplication *application;
+};
+
+typedef enum
+{
+  HWMON_TYPE_TEMP = 0,
+  HWMON_TYPE_FAN,
+  HWMON_TYPE_IN,
+  NUM_HWMON_TYPES,
+} HwmonType;
+
+/* attribute prefix and the divisor to convert from the units used by hwmon
+ * to those we display */
+static const struct
+{
+  const gchar *prefix;
+  gdouble scale;
+} hwmon_types[NUM_HWMON_TYPES] =
+{
+  { "temp", 1000.0 }, /* millidegree Celsius */
+  { "fan", 1.0 }, /* RPM */
+  { "in", 1000.0 }, /* millivolts */
+};
+
+/* chips which are read by a plugin of their own - drive temperatures in
+ * particular must not be read on the main loop since reading one sends a
+ * command to the drive */
+static const gchar * const owned_chips[] =
+{
+  "amdgpu", /* amdgpu plugin */
+  "drivetemp", /* storage plugin */
+  "nvme", /* storage plugin */
+};
+
+/* bound to each sensor as the user data for its update-value handler so
+ * reading a sample needs no lookup */
+typedef struct
+{
+  gint fd;
+  gdouble scale;
+  HwmonType type;
+} HwmonInput;
+
+static void is_hwmon_plugin_finalize(GObject *object);
+
+static void
+is_hwmon_plugin_set_property(GObject *object,
+                             guint prop_id,
+                             const GValue *value,
+                             GParamSpec *pspec)
+{
+  IsHwmonPlugin *plugin = IS_HWMON_PLUGIN(object);
+
+  switch (prop_id)
+  {
+    case PROP_OBJECT:
+      plugin->priv->application = IS_APPLICATION(g_value_dup_object(value));
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+is_hwmon_plugin_get_property(GObject *object,
+                             guint prop_id,
+                             GValue *value,
+                             GParamSpec *pspec)
+{
+  IsHwmonPlugin *plugin = IS_HWMON_PLUGIN(object);
+
+  switch (prop_id)
+  {
+    case PROP_OBJECT:
+      g_value_set_object(value, plugin->priv->application);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+is_hwmon_plugin_init(IsHwmonPlugin *self)
+{
+  IsHwmonPluginPrivate *priv =
+    G_TYPE_INSTANCE_GET_PRIVATE(self, IS_TYPE_HWMON_PLUGIN,
+                                IsHwmonPluginPrivate);
+
+  self->priv = priv;
+}
+
+static void
+is_hwmon_plugin_finalize(GObject *object)
+{
+  IsHwmonPlugin *self = IS_HWMON_PLUGIN(object);
+  IsHwmonPluginPrivate *priv = self->priv;
+
+  if (priv->application)
+  {
+    g_object_unref(priv->application);
+    priv->application = NULL;
+  }
+  G_OBJECT_CLASS(is_hwmon_plugin_parent_class)->finalize(object);
+}
+
+static void
+hwmon_input_free(HwmonInput *input,
+                 GClosure *closure)
+{
+  is_sysfs_close(input->fd);
+  g_slice_free(HwmonInput, input);
+}
+
+static void
+update_sensor_value(IsSensor *sensor,
+                    HwmonInput *input)
+{
+  gint64 raw;
+  gdouble value;
+
+  if (!is_sysfs_read_int(input->fd, &raw))
+  {
+    const gchar *reason = g_strerror(errno);
+    gchar *error = g_strdup_printf(/* first placeholder is sensor name,
+                                    * second is error message */
+                                   _("Error getting sensor value for sensor %s: %s"),
+                                   is_sensor_get_path(sensor), reason);
+    is_sensor_set_error(sensor, error);
+    g_free(error);
+    goto out;
+  }
+  value = (gdouble)raw / input->scale;
+  if (input->type == HWMON_TYPE_TEMP)
+  {
+    is_temperature_sensor_set_celsius_value(IS_TEMPERATURE_SENSOR(sensor),
+                                            value);
+  }
+  else
+  {
+    is_sensor_set_value(sensor, value);
+  }
+  is_sensor_set_error(sensor, NULL);
+
+out:
+  return;
+}
+
+static gboolean
+get_limit(const gchar *dir,
+          const gchar *attr,
+          const gchar *limit,
+          gdouble scale,
+          gdouble *value)
+{
+  gchar *name;
+  gint64 raw;
+  gboolean ret;
+
+  name = g_strdup_printf("%s_%s", attr, limit);
+  ret = is_sysfs_get_int(dir, name, &raw);
+  if (ret)
+  {
+    *value = (gdouble)raw / scale;
+  }
+  g_free(name);
+  return ret;
+}
+
+static void
+process_input(IsHwmonPlugin *self,
+              const gchar *dir,
+              const gchar *chip,
+              HwmonType type,
+              guint n)
+{
+  IsHwmonPluginPrivate *priv = self->priv;
+  HwmonInput *input;
+  IsSensor *sensor;
+  gchar *attr, *name, *label, *path;
+  gdouble min, max;
+  gint fd;
+
+  attr = g_strdup_printf("%s%u", hwmon_types[type].prefix, n);
+  name = g_strdup_printf("%s_input", attr);
+  fd = is_sysfs_open(dir, name);
+  g_free(name);
+  if (fd < 0)
+  {
+    is_warning("hwmon", "could not open input for sensor %s/%s: %s",
+               chip, attr, g_strerror(errno));
+    goto out;
+  }
+
+  name = g_strdup_printf("%s_label", attr);
+  label = is_sysfs_get_string(dir, name);
+  g_free(name);
+
+  path = g_strdup_printf(HWMON_PATH_PREFIX "/%s/%s", chip, attr);
+  switch (type)
+  {
+    case HWMON_TYPE_TEMP:
+      sensor = is_temperature_sensor_new(path);
+      is_sensor_set_icon(sensor, IS_STOCK_CPU);
+      break;
+
+    case HWMON_TYPE_FAN:
+      sensor = is_fan_sensor_new(path);
+      /* display fan readings to 0 decimal places like
+         sensors command */
+      is_sensor_set_digits(sensor, 0);
+      break;
+
+    case HWMON_TYPE_IN:
+    default:
+      sensor = is_sensor_new(path);
+      /* display voltage readings to 2 decimal places like
+         sensors command */
+      is_sensor_set_digits(sensor, 2);
+      /* translators: V is the unit for Voltage, replace with
+         appropriate unit */
+      is_sensor_set_units(sensor, _("V"));
+      is_sensor_set_icon(sensor, IS_STOCK_CHIP);
+      break;
+  }
+  g_free(path);
+  is_sensor_set_label(sensor, (label && *label) ? label : attr);
+  g_free(label);
+
+  if (get_limit(dir, attr, "min", hwmon_types[type].scale, &min))
+  {
+    is_sensor_set_alarm_mode(sensor, IS_SENSOR_ALARM_MODE_LOW);
+    is_sensor_set_alarm_value(sensor, min);
+    if (type == HWMON_TYPE_TEMP)
+    {
+      is_sensor_set_low_value(sensor, min);
+    }
+  }
+  if (type == HWMON_TYPE_TEMP &&
+      (get_limit(dir, attr, "max", hwmon_types[type].scale, &max) ||
+       get_limit(dir, attr, "crit", hwmon_types[type].scale, &max)))
+  {
+    is_sensor_set_alarm_mode(sensor, IS_SENSOR_ALARM_MODE_HIGH);
+    is_sensor_set_alarm_value(sensor, max);
+    is_sensor_set_high_value(sensor, max);
+  }
+
+  input = g_slice_new(HwmonInput);
+  input->fd = fd;
+  input->scale = hwmon_types[type].scale;
+  input->type = type;
+  /* input is freed along with the handler when the sensor is */
+  g_signal_connect_data(sensor, "update-value",
+                        G_CALLBACK(update_sensor_value),
+                        input, (GClosureNotify)hwmon_input_free, 0);
+  is_manager_add_sensor(is_application_get_manager(priv->application),
+                        sensor);
+  g_object_unref(sensor);
+
+out:
+  g_free(attr);
+}
+
+/* returns a name for the chip which is stable across reboots unlike the
+ * hwmonN directory name, by combining the driver name with the name of the
+ * underlying device where there is one */
+static gchar *
+get_chip_name(const gchar *dir,
+              const gchar *hwmon)
+{
+  gchar *name, *link, *target, *chip;
+
+  name = is_sysfs_get_string(dir, "name");
+  if (!name || !*name)
+  {
+    g_free(name);
+    return NULL;
+  }
+  link = g_build_filename(dir, "device", NULL);
+  target = g_file_read_link(link, NULL);
+  if (target)
+  {
+    gchar *device = g_path_get_basename(target);
+    chip = g_strdup_printf("%s-%s", name, device);
+    g_free(device);
+  }
+  else
+  {
+    chip = g_strdup_printf("%s-%s", name, hwmon);
+  }
+  g_free(target);
+  g_free(link);
+  g_free(name);
+  /* path components are separated by / */
+  return g_strdelimit(chip, "/", '_');
+}
+
+static gboolean
+chip_is_owned(const gchar *dir)
+{
+  gchar *name;
+  gboolean ret = FALSE;
+  guint i;
+
+  name = is_sysfs_get_string(dir, "name");
+  for (i = 0; name && i < G_N_ELEMENTS(owned_chips); i++)
+  {
+    if (g_strcmp0(name, owned_chips[i]) == 0)
+    {
+      ret = TRUE;
+    }
+  }
+  g_free(name);
+  return ret;
+}
+
+static void
+process_hwmon_device(IsHwmonPlugin *self,
+                     const gchar *hwmon)
+{
+  gchar *dir, *chip;
+  const gchar *entry;
+  GDir *gdir;
+
+  dir = g_build_filename(HWMON_CLASS_DIR, hwmon, NULL);
+  chip = get_chip_name(dir, hwmon);
+  if (!chip)
+  {
+    /* older drivers put their attributes on the device rather than the
+     * hwmon class device */
+    gchar *device_dir = g_build_filename(dir, "device", NULL);
+    g_free(dir);
+    dir = device_dir;
+    chip = get_chip_name(dir, hwmon);
+  }
+  if (!chip)
+  {
+    is_debug("hwmon", "ignoring %s as it has no name", hwmon);
+    goto out;
+  }
+  if (chip_is_owned(dir))
+  {
+    is_debug("hwmon", "ignoring %s as it is read by another plugin", chip);
+    goto out;
+  }
+
+  gdir = g_dir_open(dir, 0, NULL);
+  if (!gdir)
+  {
+    goto out;
+  }
+  while ((entry = g_dir_read_name(gdir)) != NULL)
+  {
+    HwmonType type;
+
+    for (type = 0; type < NUM_HWMON_TYPES; type++)
+    {
+      const gchar *prefix = hwmon_types[type].prefix;
+      gsize len = strlen(prefix);
+      guint64 n;
+      gchar *end;
+
+      if (strncmp(entry, prefix, len) != 0 ||
+          !g_ascii_isdigit(entry[len]))
+      {
+        continue;
+      }
+      n = g_ascii_strtoull(entry + len, &end, 10);
+      if (strcmp(end, "_input") == 0 && n <= G_MAXUINT)
+      {
+        process_input(self, dir, chip, type, (guint)n);
+      }
+      break;
+    }
+  }
+  g_dir_close(gdir);
+
+out:
+  g_free(chip);
+  g_free(dir);
+}
+
+static void
+is_hwmon_plugin_activate(PeasActivatable *activatable)
+{
+  IsHwmonPlugin *self = IS_HWMON_PLUGIN(activatable);
+  const gchar *entry;
+  GDir *dir;
+  GError *error = NULL;
+
+  /* discover all inputs once - each keeps its attribute open for the
+   * lifetime of its sensor */
+  dir = g_dir_open(HWMON_CLASS_DIR, 0, &error);
+  if (!dir)
+  {
+    is_debug("hwmon", "unable to find sensors: %s", error->message);
+    g_error_free(error);
+    goto out;
+  }
+  is_debug("hwmon", "searching for sensors");
+  while ((entry = g_dir_read_name(dir)) != NULL)
+  {
+    process_hwmon_device(self, entry);
+  }
+  g_dir_close(dir);
+
+out:
+  return;
+}
+
+static void
+is_hwmon_plugin_deactivate(PeasActivatable *activatable)
+{
+  IsHwmonPlugin *plugin = IS_HWMON_PLUGIN(activatable);
+  IsHwmonPluginPrivate *priv = plugin->priv;
+  IsManager *manager;
+
+  manager = is_application_get_manager(priv->application);
+  is_manager_remove_paths_with_prefix(manager, HWMON_PATH_PREFIX);
+}
+
+static void
+is_hwmon_plugin_class_init(IsHwmonPluginClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+  g_type_class_add_private(klass, sizeof(IsHwmonPluginPrivate));
+
+  gobject_class->get_property = is_hwmon_plugin_get_property;
+  gobject_class->set_property = is_hwmon_plugin_set_property;
+  gobject_class->finalize = is_hwmon_plugin_finalize;
+
+  g_object_class_override_property(gobject_class, PROP_OBJECT, "object");
+}
+
+static void
+peas_activatable_iface_init(PeasActivatableInterface *iface)
+{
+  iface->activate = is_hwmon_plugin_activate;
+  iface->deactivate = is_hwmon_plugin_deactivate;
+}
+
+static void
+is_hwmon_plugin_class_finalize(IsHwmonPluginClass *klass)
+{
+  /* nothing to do */
+}
+
+G_MODULE_EXPORT void
+peas_register_types(PeasObjectModule *module)
+{
+  is_hwmon_plugin_register_type(G_TYPE_MODULE(module));
+
+  peas_object_module_register_extension_type(module,
+      PEAS_TYPE_ACTIVATABLE,
+      IS_TYPE_HWMON_PLUGIN);
+}
@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2011-2019 Alex Murray <murray.alex@gmail.com>
+ *
+ * indicator-sensors is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * indicator-sensors is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with indicator-sensors.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Compares the per-read cost of finding the chip and subfeature of a
+ * libsensors sensor from its path (as update_sensor_value() used to) with
+ * taking them from a binding made at creation, both on their own and
+ * together with the sensors_get_value() they precede. Not built by default
+ * - build with 'make bench-update-value' and run as
+ * './bench-update-value [iterations]' on a machine with lm-sensors
+ * configured. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <glib.h>
+#include <sensors/sensors.h>
+
+#define DEFAULT_ITERATIONS 1000
+/* lookups on their own are so cheap they need many more iterations than
+ * hardware reads to be timed */
+#define LOOKUP_ONLY_FACTOR 1000
+
+typedef struct
+{
+  const sensors_chip_name *chip;
+  int nr;
+} Binding;
+
+typedef struct
+{
+  gchar *path;
+  Binding binding;
+} Input;
+
+/* as update_sensor_value() did before sensors were bound at creation */
+static int
+lookup_by_path(GHashTable *chips,
+               const gchar *path,
+               const sensors_chip_name **chip)
+{
+  gchar *offset, *end;
+
+  *chip = g_hash_table_lookup(chips, path);
+  offset = g_strrstr(path, "/");
+  return (int)g_ascii_strtoll(offset + 1, &end, 10);
+}
+
+/* returns the mean nanoseconds per read */
+static gdouble
+run(GPtrArray *inputs,
+    GHashTable *chips,
+    gboolean bound,
+    gboolean read,
+    guint iterations)
+{
+  volatile gdouble sink = 0.0;
+  gint64 start;
+  guint i, j;
+
+  start = g_get_monotonic_time();
+  for (i = 0; i < iterations; i++)
+  {
+    for (j = 0; j < inputs->len; j++)
+    {
+      Input *input = g_ptr_array_index(inputs, j);
+      const sensors_chip_name *chip;
+      double value;
+      int nr;
+
+      if (bound)
+      {
+        chip = input->binding.chip;
+        nr = input->binding.nr;
+      }
+      else
+      {
+        nr = lookup_by_path(chips, input->path, &chip);
+      }
+      value = nr;
+      if (read)
+      {
+        sensors_get_value(chip, nr, &value);
+      }
+      sink += value;
+    }
+  }
+  return ((gdouble)(g_get_monotonic_time() - start) * 1000.0 /
+          ((gdouble)iterations * inputs->len));
+}
+
+static void
+add_inputs(GPtrArray *inputs,
+           GHashTable *chips,
+           const sensors_chip_name *chip)
+{
+  const sensors_feature *feature;
+  char name[200];
+  int nr = 0;
+
+  if (sensors_snprintf_chip_name(name, sizeof(name), chip) < 0)
+  {
+    return;
+  }
+  while ((feature = sensors_get_features(chip, &nr)))
+  {
+    const sensors_subfeature *subfeature;
+    Input *input;
+    int s = 0;
+
+    /* the input is always the first subfeature of a feature */
+    subfeature = sensors_get_all_subfeatures(chip, feature, &s);
+    if (!subfeature || !(subfeature->flags & SENSORS_MODE_R))
+    {
+      continue;
+    }
+    input = g_slice_new(Input);
+    input->path = g_strdup_printf("libsensors/%s/%d", name,
+                                  subfeature->number);
+    input->binding.chip = chip;
+    input->binding.nr = subfeature->number;
+    g_ptr_array_add(inputs, input);
+    g_hash_table_insert(chips, input->path, (gpointer)chip);
+  }
+}
+
+static void
+input_free(Input *input)
+{
+  g_free(input->path);
+  g_slice_free(Input, input);
+}
+
+int main(int argc, char **argv)
+{
+  const sensors_chip_name *chip;
+  GHashTable *chips;
+  GPtrArray *inputs;
+  guint iterations = DEFAULT_ITERATIONS;
+  int nr = 0;
+  int ret = EXIT_FAILURE;
+
+  if (argc > 1)
+  {
+    iterations = (guint)g_ascii_strtoull(argv[1], NULL, 10);
+  }
+  if (!iterations || sensors_init(NULL) != 0)
+  {
+    fprintf(stderr, "usage: %s [iterations] (with lm-sensors configured)\n",
+            argv[0]);
+    goto out;
+  }
+
+  chips = g_hash_table_new(g_str_hash, g_str_equal);
+  inputs = g_ptr_array_new_with_free_func((GDestroyNotify)input_free);
+  while ((chip = sensors_get_detected_chips(NULL, &nr)))
+  {
+    add_inputs(inputs, chips, chip);
+  }
+  if (inputs->len == 0)
+  {
+    fprintf(stderr, "no sensors detected - try running sensors-detect\n");
+  }
+  else
+  {
+    printf("%u inputs, nanoseconds per read\n", inputs->len);
+    printf("lookup only: path %.1f, binding %.1f\n",
+           run(inputs, chips, FALSE, FALSE, iterations * LOOKUP_ONLY_FACTOR),
+           run(inputs, chips, TRUE, FALSE, iterations * LOOKUP_ONLY_FACTOR));
+    printf("with read:   path %.1f, binding %.1f\n",
+           run(inputs, chips, FALSE, TRUE, iterations),
+           run(inputs, chips, TRUE, TRUE, iterations));
+    ret = EXIT_SUCCESS;
+  }
+  g_hash_table_destroy(chips);
+  g_ptr_array_free(inputs, TRUE);
+  sensors_cleanup();
+
+out:
+  return ret;
+}
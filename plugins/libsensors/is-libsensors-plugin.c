@@ -23,6 +23,9 @@
 #include <stdlib.h>
 #include <indicator-sensors/is-temperature-sensor.h>
 #include <indicator-sensors/is-fan-sensor.h>
+#include <indicator-sensors/is-power-sensor.h>
+#include <indicator-sensors/is-energy-sensor.h>
+#include <indicator-sensors/is-current-sensor.h>
 #include <indicator-sensors/is-application.h>
 #include <indicator-sensors/is-log.h>
 #include <indicator-sensors/is-notify.h>
@@ -31,6 +34,23 @@
 #include <glib/gi18n.h>
 
 #define LIBSENSORS_PATH_PREFIX "libsensors"
+/* default time in milliseconds a chip can take to be sampled before its
+ * sensors are marked as in error - 0 to wait forever */
+#define DEFAULT_CHIP_TIMEOUT 5000
+/* chips are sampled in parallel on this many threads - plus one for each
+ * chip which has timed out until it returns */
+#define MAX_SAMPLING_THREADS 8
+/* seconds between re-reading the limits of a sensor */
+#define LIMITS_REFRESH_INTERVAL (10 * 60)
+#define LIMIT_EPSILON 0.001
+
+/* chips which are read by a plugin of their own */
+static const gchar * const owned_chips[] =
+{
+  "amdgpu", /* amdgpu plugin */
+  "drivetemp", /* storage plugin */
+  "nvme", /* storage plugin */
+};
 
 static void peas_activatable_iface_init(PeasActivatableInterface *iface);
 
@@ -44,16 +64,81 @@ G_DEFINE_DYNAMIC_TYPE_EXTENDED(IsLibsensorsPlugin,
 enum
 {
   PROP_OBJECT = 1,
+  PROP_CHIP_TIMEOUT,
 };
 
 struct _IsLibsensorsPluginPrivate
 {
   IsApplication *application;
   gboolean inited;
-  GHashTable *sensor_chip_names;
+  guint n_sensors;
+  /* LibsensorsChip for each sensors_chip_name */
+  GHashTable *chips;
+  GThreadPool *pool;
+  /* chips whose sampling has completed, waiting to be published */
+  GAsyncQueue *results;
+  guint chip_timeout;
+  guint dispatch_id;
+  GSettings *settings;
+};
+
+typedef struct _LibsensorsChip LibsensorsChip;
+
+/* bound to each sensor at creation as the user data of its update-value
+ * handler so reading a value needs no lookup or parsing of its path */
+typedef struct
+{
+  LibsensorsChip *chip;
+  IsSensor *sensor;
+  int nr;
+  gboolean temperature;
+  gboolean energy;
+  /* whether sensor is in chip->pending */
+  gboolean queued;
+  /* subfeatures of the limits, or -1 if the chip has none */
+  int min_nr;
+  int max_nr;
+  /* whether limits are read along with the value in the current sample and
+   * when they were last read */
+  gboolean read_limits;
+  gint64 limits_read;
+  /* result of the last sample, written on a sampling thread */
+  gdouble value;
+  int ret;
+  gint64 timestamp;
+  gdouble min;
+  int min_ret;
+  gdouble max;
+  int max_ret;
+  /* limits as last applied to the sensor (in celsius for temperatures) so
+   * any the user has since changed are left alone */
+  IsSensorAlarmMode applied_alarm_mode;
+  gdouble applied_alarm_value;
+  gdouble applied_low_value;
+  gdouble applied_high_value;
+} LibsensorsBinding;
+
+/* all reads for a chip are done together by a single task on the thread
+ * pool so one slow chip only delays its own sensors - only one task per chip
+ * is ever in flight */
+struct _LibsensorsChip
+{
+  IsLibsensorsPlugin *plugin;
+  const sensors_chip_name *chip_name;
+  gchar *name;
+  /* bindings which are due to be sampled by the next task */
+  GPtrArray *pending;
+  /* bindings being sampled by the in flight task */
+  GPtrArray *sampling;
+  gboolean busy;
+  /* fires if the in flight task takes longer than chip-timeout */
+  guint timeout_id;
+  gboolean timed_out;
 };
 
 static void is_libsensors_plugin_finalize(GObject *object);
+static void libsensors_chip_free(LibsensorsChip *chip);
+static void sample_chip(LibsensorsChip *chip, IsLibsensorsPlugin *self);
 
 static void
 is_libsensors_plugin_set_property(GObject *object,
@@ -69,6 +154,10 @@ is_libsensors_plugin_set_property(GObject *object,
       plugin->priv->application = IS_APPLICATION(g_value_dup_object(value));
       break;
 
+    case PROP_CHIP_TIMEOUT:
+      plugin->priv->chip_timeout = g_value_get_uint(value);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
       break;
@@ -89,6 +178,10 @@ is_libsensors_plugin_get_property(GObject *object,
       g_value_set_object(value, plugin->priv->application);
       break;
 
+    case PROP_CHIP_TIMEOUT:
+      g_value_set_uint(value, plugin->priv->chip_timeout);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
       break;
@@ -105,6 +198,15 @@ is_libsensors_plugin_init(IsLibsensorsPlugin *self)
                                 IsLibsensorsPluginPrivate);
 
   self->priv = priv;
+  priv->chip_timeout = DEFAULT_CHIP_TIMEOUT;
+  priv->chips = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                      NULL, (GDestroyNotify)libsensors_chip_free);
+  priv->results = g_async_queue_new();
+  priv->pool = g_thread_pool_new((GFunc)sample_chip, self,
+                                 MAX_SAMPLING_THREADS, FALSE, NULL);
+  priv->settings = g_settings_new("indicator-sensors.libsensors");
+  g_settings_bind(priv->settings, "chip-timeout", self, "chip-timeout",
+                  G_SETTINGS_BIND_GET);
 
   is_debug("libsensors", "Trying to initialise libsensors with default path...\n");
   res = sensors_init(NULL);
@@ -132,10 +234,6 @@ is_libsensors_plugin_init(IsLibsensorsPlugin *self)
   }
   if (res == 0)
   {
-    priv->sensor_chip_names = g_hash_table_new_full(g_str_hash,
-                              g_str_equal,
-                              g_free,
-                              NULL);
     priv->inited = TRUE;
   }
 }
@@ -146,9 +244,21 @@ is_libsensors_plugin_finalize(GObject *object)
   IsLibsensorsPlugin *self = (IsLibsensorsPlugin *)object;
   IsLibsensorsPluginPrivate *priv = self->priv;
 
-  if (priv->sensor_chip_names)
+  if (priv->dispatch_id)
+  {
+    g_source_remove(priv->dispatch_id);
+    priv->dispatch_id = 0;
+  }
+  g_clear_object(&priv->settings);
+  /* every task and pending publish holds a reference on us so there is
+   * nothing left in flight by now */
+  g_thread_pool_free(priv->pool, FALSE, TRUE);
+  g_async_queue_unref(priv->results);
+  g_hash_table_destroy(priv->chips);
+  if (priv->application)
   {
-    g_hash_table_destroy(priv->sensor_chip_names);
+    g_object_unref(priv->application);
+    priv->application = NULL;
   }
   /* think about storing this in the class structure so we only init once
      and unload once */
@@ -178,51 +288,73 @@ static gchar *get_chip_name_string(const sensors_chip_name *chip)
 }
 
 static void
-update_sensor_value(IsSensor *sensor,
-                    IsLibsensorsPlugin *self)
+libsensors_binding_free(LibsensorsBinding *binding,
+                        GClosure *closure)
 {
-  const gchar *path;
-  const sensors_chip_name *found_chip;
-  gchar *offset, *end;
-  int n, ret;
-  gdouble value = is_sensor_get_value(sensor);
-
-  path = is_sensor_get_path(sensor);
+  g_slice_free(LibsensorsBinding, binding);
+}
 
-  found_chip = g_hash_table_lookup(self->priv->sensor_chip_names,
-                                   path);
-  g_assert(found_chip != NULL);
+static LibsensorsChip *
+libsensors_chip_new(IsLibsensorsPlugin *plugin,
+                    const sensors_chip_name *chip_name,
+                    const gchar *name)
+{
+  LibsensorsChip *chip = g_slice_new0(LibsensorsChip);
+  chip->plugin = plugin;
+  chip->chip_name = chip_name;
+  chip->name = g_strdup(name);
+  chip->pending = g_ptr_array_new();
+  chip->sampling = g_ptr_array_new();
+  return chip;
+}
 
-  /* get last separator */
-  offset = g_strrstr(path, "/");
-  g_assert(offset != NULL);
+static void
+libsensors_chip_free(LibsensorsChip *chip)
+{
+  g_assert(!chip->busy);
+  g_ptr_array_free(chip->sampling, TRUE);
+  g_ptr_array_free(chip->pending, TRUE);
+  g_free(chip->name);
+  g_slice_free(LibsensorsChip, chip);
+}
 
-  n = (int)g_ascii_strtoll(offset + 1, &end, 10);
-  /* conversion should also never fail */
-  g_assert(end != NULL);
+static void
+publish_binding(LibsensorsBinding *binding)
+{
+  IsSensor *sensor = binding->sensor;
 
   /* ignore IO error */
-  if ((ret = sensors_get_value(found_chip, n, &value)) < 0 &&
-      ret != -SENSORS_ERR_IO)
+  if (binding->ret < 0 && binding->ret != -SENSORS_ERR_IO)
   {
     GError *error = g_error_new(g_quark_from_string("libsensors-plugin-error-quark"),
                                 0,
                                 /* first placeholder is sensor name,
                                  * second is error message */
                                 _("Error getting sensor value for sensor %s: %s [%d]"),
-                                path, sensors_strerror(ret), ret);
+                                is_sensor_get_path(sensor),
+                                sensors_strerror(binding->ret), binding->ret);
     is_sensor_set_error(sensor, error->message);
     g_error_free(error);
     goto out;
   }
-  if (IS_IS_TEMPERATURE_SENSOR(sensor))
-  {
-    is_temperature_sensor_set_celsius_value(IS_TEMPERATURE_SENSOR(sensor),
-                                            value);
-  }
-  else
+  if (binding->ret == 0)
   {
-    is_sensor_set_value(sensor, value);
+    if (binding->temperature)
+    {
+      is_temperature_sensor_set_celsius_value(IS_TEMPERATURE_SENSOR(sensor),
+                                              binding->value);
+    }
+    else if (binding->energy)
+    {
+      /* libsensors gives joules */
+      is_energy_sensor_set_energy(IS_ENERGY_SENSOR(sensor),
+                                  (guint64)(binding->value * 1000000.0),
+                                  binding->timestamp);
+    }
+    else
+    {
+      is_sensor_set_value(sensor, binding->value);
+    }
   }
   is_sensor_set_error(sensor, NULL);
 
@@ -230,6 +362,337 @@ out:
   return;
 }
 
+static gdouble
+to_sensor_units(LibsensorsBinding *binding,
+                gdouble value)
+{
+  if (binding->temperature)
+  {
+    value = is_temperature_sensor_from_celsius(IS_TEMPERATURE_SENSOR(binding->sensor),
+                                               value);
+  }
+  return value;
+}
+
+/* returns whether the sensor should take a newly read limit - only a value
+ * which is still the one we last applied gets replaced */
+static gboolean
+update_limit(LibsensorsBinding *binding,
+             gdouble current,
+             gdouble *applied,
+             gdouble limit)
+{
+  gboolean ret = FALSE;
+
+  if (ABS(current - to_sensor_units(binding, *applied)) < LIMIT_EPSILON)
+  {
+    *applied = limit;
+    ret = TRUE;
+  }
+  else if (ABS(current - to_sensor_units(binding, limit)) < LIMIT_EPSILON)
+  {
+    /* user has ended up with the same value so track it from now on */
+    *applied = limit;
+  }
+  return ret;
+}
+
+static void
+publish_limits(LibsensorsBinding *binding)
+{
+  IsSensor *sensor = binding->sensor;
+  IsSensorAlarmMode alarm_mode = IS_SENSOR_ALARM_MODE_DISABLED;
+  IsSensorAlarmMode current_mode;
+  gdouble alarm_value = 0.0;
+
+  if (binding->min_ret == 0)
+  {
+    alarm_mode = IS_SENSOR_ALARM_MODE_LOW;
+    alarm_value = binding->min;
+  }
+  if (binding->max_ret == 0)
+  {
+    alarm_mode = IS_SENSOR_ALARM_MODE_HIGH;
+    alarm_value = binding->max;
+  }
+  if (alarm_mode != IS_SENSOR_ALARM_MODE_DISABLED)
+  {
+    /* set value before mode so we don't alarm against a stale value */
+    if (update_limit(binding, is_sensor_get_alarm_value(sensor),
+                     &binding->applied_alarm_value, alarm_value))
+    {
+      is_sensor_set_alarm_value(sensor, to_sensor_units(binding, alarm_value));
+    }
+    current_mode = is_sensor_get_alarm_mode(sensor);
+    if (current_mode == binding->applied_alarm_mode ||
+        current_mode == alarm_mode)
+    {
+      is_sensor_set_alarm_mode(sensor, alarm_mode);
+      binding->applied_alarm_mode = alarm_mode;
+    }
+  }
+  if (!binding->temperature)
+  {
+    return;
+  }
+  if (binding->min_ret == 0 &&
+      update_limit(binding, is_sensor_get_low_value(sensor),
+                   &binding->applied_low_value, binding->min))
+  {
+    is_sensor_set_low_value(sensor, to_sensor_units(binding, binding->min));
+  }
+  if (binding->max_ret == 0 &&
+      update_limit(binding, is_sensor_get_high_value(sensor),
+                   &binding->applied_high_value, binding->max))
+  {
+    is_sensor_set_high_value(sensor, to_sensor_units(binding, binding->max));
+  }
+}
+
+static gboolean
+limits_due(LibsensorsBinding *binding,
+           gint64 now)
+{
+  return ((binding->min_nr >= 0 || binding->max_nr >= 0) &&
+          (!binding->limits_read ||
+           now - binding->limits_read >=
+           (gint64)LIMITS_REFRESH_INTERVAL * G_USEC_PER_SEC));
+}
+
+static gboolean
+chip_timed_out(LibsensorsChip *chip)
+{
+  IsLibsensorsPluginPrivate *priv = chip->plugin->priv;
+  guint i;
+
+  is_warning("libsensors", "Timed out sampling chip %s", chip->name);
+  chip->timeout_id = 0;
+  chip->timed_out = TRUE;
+  for (i = 0; i < chip->sampling->len; i++)
+  {
+    LibsensorsBinding *binding = g_ptr_array_index(chip->sampling, i);
+    gchar *error = g_strdup_printf(/* first placeholder is sensor name,
+                                    * second is chip name */
+                                   _("Error getting sensor value for sensor %s: timed out reading chip %s"),
+                                   is_sensor_get_path(binding->sensor),
+                                   chip->name);
+    is_sensor_set_error(binding->sensor, error);
+    g_free(error);
+  }
+  /* the task may never return so make up for the thread it holds until it
+   * does */
+  g_thread_pool_set_max_threads(priv->pool,
+                                g_thread_pool_get_max_threads(priv->pool) + 1,
+                                NULL);
+  return FALSE;
+}
+
+static void
+dispatch_chip(IsLibsensorsPlugin *self,
+              LibsensorsChip *chip)
+{
+  GPtrArray *sampling;
+  gint64 now;
+  guint i;
+
+  g_assert(!chip->busy);
+
+  now = g_get_monotonic_time();
+  /* swap so anything which becomes due while this task is in flight gets
+   * queued for the next one */
+  sampling = chip->sampling;
+  chip->sampling = chip->pending;
+  chip->pending = sampling;
+  for (i = 0; i < chip->sampling->len; i++)
+  {
+    LibsensorsBinding *binding = g_ptr_array_index(chip->sampling, i);
+    binding->queued = FALSE;
+    /* limits are only read when a sensor is first sampled and then every
+     * so often */
+    binding->read_limits = limits_due(binding, now);
+  }
+  chip->busy = TRUE;
+  chip->timed_out = FALSE;
+  if (self->priv->chip_timeout)
+  {
+    chip->timeout_id = g_timeout_add(self->priv->chip_timeout,
+                                     (GSourceFunc)chip_timed_out, chip);
+  }
+  /* task holds a reference on us until its results are published */
+  g_object_ref(self);
+  g_thread_pool_push(self->priv->pool, chip, NULL);
+}
+
+static gboolean
+publish_results(IsLibsensorsPlugin *self)
+{
+  IsLibsensorsPluginPrivate *priv = self->priv;
+  LibsensorsChip *chip;
+
+  /* publish every chip which has completed so far in one go - any later
+   * idles for chips published here find nothing to do */
+  while ((chip = g_async_queue_try_pop(priv->results)) != NULL)
+  {
+    guint i;
+
+    for (i = 0; i < chip->sampling->len; i++)
+    {
+      LibsensorsBinding *binding = g_ptr_array_index(chip->sampling, i);
+      is_sensor_freeze_changed(binding->sensor);
+      publish_binding(binding);
+      if (binding->read_limits)
+      {
+        /* limits from the chip are defaults rather than something the
+         * user has set so must not be saved to their config */
+        is_sensor_freeze_config(binding->sensor);
+        publish_limits(binding);
+        is_sensor_thaw_config(binding->sensor);
+        binding->limits_read = g_get_monotonic_time();
+        binding->read_limits = FALSE;
+      }
+      is_sensor_thaw_changed(binding->sensor);
+      /* drop reference taken when queued */
+      g_object_unref(binding->sensor);
+    }
+    g_ptr_array_set_size(chip->sampling, 0);
+    chip->busy = FALSE;
+    if (chip->timeout_id)
+    {
+      g_source_remove(chip->timeout_id);
+      chip->timeout_id = 0;
+    }
+    if (chip->timed_out)
+    {
+      /* give back the thread added when it timed out */
+      g_thread_pool_set_max_threads(priv->pool,
+                                    g_thread_pool_get_max_threads(priv->pool) - 1,
+                                    NULL);
+      chip->timed_out = FALSE;
+    }
+    /* sample anything which became due in the meantime straight away */
+    if (chip->pending->len > 0)
+    {
+      dispatch_chip(self, chip);
+    }
+  }
+  return FALSE;
+}
+
+/* called on a thread from the pool */
+static void
+sample_chip(LibsensorsChip *chip,
+            IsLibsensorsPlugin *self)
+{
+  guint i;
+
+  for (i = 0; i < chip->sampling->len; i++)
+  {
+    LibsensorsBinding *binding = g_ptr_array_index(chip->sampling, i);
+    binding->ret = sensors_get_value(chip->chip_name, binding->nr,
+                                     &binding->value);
+    binding->timestamp = g_get_monotonic_time();
+    if (binding->read_limits)
+    {
+      binding->min_ret = (binding->min_nr >= 0 ?
+                          sensors_get_value(chip->chip_name, binding->min_nr,
+                                            &binding->min) :
+                          -SENSORS_ERR_NO_ENTRY);
+      binding->max_ret = (binding->max_nr >= 0 ?
+                          sensors_get_value(chip->chip_name, binding->max_nr,
+                                            &binding->max) :
+                          -SENSORS_ERR_NO_ENTRY);
+    }
+  }
+  g_async_queue_push(self->priv->results, chip);
+  /* hands the reference taken in dispatch_chip() to the idle */
+  g_idle_add_full(G_PRIORITY_DEFAULT_IDLE, (GSourceFunc)publish_results,
+                  self, g_object_unref);
+}
+
+static void
+dispatch_pending(IsLibsensorsPlugin *self)
+{
+  GHashTableIter iter;
+  LibsensorsChip *chip;
+
+  g_hash_table_iter_init(&iter, self->priv->chips);
+  while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&chip))
+  {
+    if (!chip->busy && chip->pending->len > 0)
+    {
+      dispatch_chip(self, chip);
+    }
+  }
+}
+
+static gboolean
+dispatch_pending_idle(IsLibsensorsPlugin *self)
+{
+  self->priv->dispatch_id = 0;
+  dispatch_pending(self);
+  return FALSE;
+}
+
+static void
+queue_binding(LibsensorsBinding *binding)
+{
+  IsLibsensorsPlugin *self = binding->chip->plugin;
+  IsLibsensorsPluginPrivate *priv = self->priv;
+
+  if (!binding->queued)
+  {
+    binding->queued = TRUE;
+    /* keep sensor alive until its sample is published */
+    g_object_ref(binding->sensor);
+    g_ptr_array_add(binding->chip->pending, binding);
+  }
+  /* may have been asked for outside of a tick (ie. limits requested when
+   * the sensor dialog is opened) so make sure it still gets sampled */
+  if (!priv->dispatch_id)
+  {
+    priv->dispatch_id = g_idle_add((GSourceFunc)dispatch_pending_idle, self);
+  }
+}
+
+static void
+update_sensor_value(IsSensor *sensor,
+                    LibsensorsBinding *binding)
+{
+  /* just queue for sampling - the actual read is done for all due sensors
+   * of the chip at once from update_values() */
+  queue_binding(binding);
+}
+
+static void
+request_sensor_limits(IsSensor *sensor,
+                      LibsensorsBinding *binding)
+{
+  /* limits are read along with the value the first time the sensor is
+   * sampled and refreshed in the background after that, so only sample
+   * if that hasn't happened yet */
+  if ((binding->min_nr >= 0 || binding->max_nr >= 0) &&
+      !binding->limits_read && !binding->read_limits)
+  {
+    queue_binding(binding);
+  }
+}
+
+static void
+update_values(IsApplication *application,
+              GPtrArray *sensors,
+              IsLibsensorsPlugin *self)
+{
+  IsLibsensorsPluginPrivate *priv = self->priv;
+
+  /* no need to wait for the idle */
+  if (priv->dispatch_id)
+  {
+    g_source_remove(priv->dispatch_id);
+    priv->dispatch_id = 0;
+  }
+  dispatch_pending(self);
+}
+
 static void
 process_sensors_chip_name(IsLibsensorsPlugin *self,
                           const sensors_chip_name *chip_name)
@@ -237,6 +700,7 @@ process_sensors_chip_name(IsLibsensorsPlugin *self,
   IsLibsensorsPluginPrivate *priv = self->priv;
   gchar *chip_name_string = NULL;
   const sensors_feature *main_feature;
+  LibsensorsChip *chip;
   gint nr1 = 0;
 
   chip_name_string = get_chip_name_string(chip_name);
@@ -246,6 +710,12 @@ process_sensors_chip_name(IsLibsensorsPlugin *self,
                chip_name->path);
     goto out;
   }
+  chip = g_hash_table_lookup(priv->chips, chip_name);
+  if (!chip)
+  {
+    chip = libsensors_chip_new(self, chip_name, chip_name_string);
+    g_hash_table_insert(priv->chips, (gpointer)chip_name, chip);
+  }
   while ((main_feature = sensors_get_features(chip_name, &nr1)))
   {
     gchar *label = NULL;
@@ -254,8 +724,7 @@ process_sensors_chip_name(IsLibsensorsPlugin *self,
     const sensors_subfeature *max_feature = NULL;
     gchar *path;
     IsSensor *sensor;
-    gdouble value, min, max;
-    int ret;
+    LibsensorsBinding *binding;
 
     switch (main_feature->type)
     {
@@ -286,19 +755,57 @@ process_sensors_chip_name(IsLibsensorsPlugin *self,
                                              main_feature,
                                              SENSORS_SUBFEATURE_TEMP_MIN);
         break;
+      case SENSORS_FEATURE_POWER:
+        input_feature = sensors_get_subfeature(chip_name,
+                                               main_feature,
+                                               SENSORS_SUBFEATURE_POWER_INPUT);
+        /* many chips only provide an average */
+        if (!input_feature)
+        {
+          input_feature = sensors_get_subfeature(chip_name,
+                                                 main_feature,
+                                                 SENSORS_SUBFEATURE_POWER_AVERAGE);
+        }
+        max_feature = sensors_get_subfeature(chip_name,
+                                             main_feature,
+                                             SENSORS_SUBFEATURE_POWER_MAX);
+        break;
+      case SENSORS_FEATURE_ENERGY:
+        input_feature = sensors_get_subfeature(chip_name,
+                                               main_feature,
+                                               SENSORS_SUBFEATURE_ENERGY_INPUT);
+        break;
+      case SENSORS_FEATURE_CURR:
+        input_feature = sensors_get_subfeature(chip_name,
+                                               main_feature,
+                                               SENSORS_SUBFEATURE_CURR_INPUT);
+        max_feature = sensors_get_subfeature(chip_name,
+                                             main_feature,
+                                             SENSORS_SUBFEATURE_CURR_MAX);
+        min_feature = sensors_get_subfeature(chip_name,
+                                             main_feature,
+                                             SENSORS_SUBFEATURE_CURR_MIN);
+        break;
+#if SENSORS_API_VERSION > 0x430
+      case SENSORS_FEATURE_HUMIDITY:
+        input_feature = sensors_get_subfeature(chip_name,
+                                               main_feature,
+                                               SENSORS_SUBFEATURE_HUMIDITY_INPUT);
+        break;
+      case SENSORS_FEATURE_INTRUSION:
+        input_feature = sensors_get_subfeature(chip_name,
+                                               main_feature,
+                                               SENSORS_SUBFEATURE_INTRUSION_ALARM);
+        break;
+#endif
 
 #if SENSORS_API_VERSION > 0x432
       case SENSORS_FEATURE_MAX:
 #endif
 #if SENSORS_API_VERSION > 0x430
-      case SENSORS_FEATURE_HUMIDITY:
       case SENSORS_FEATURE_MAX_MAIN:
-      case SENSORS_FEATURE_INTRUSION:
       case SENSORS_FEATURE_MAX_OTHER:
 #endif
-      case SENSORS_FEATURE_POWER:
-      case SENSORS_FEATURE_ENERGY:
-      case SENSORS_FEATURE_CURR:
       case SENSORS_FEATURE_VID:
       case SENSORS_FEATURE_BEEP_ENABLE:
       case SENSORS_FEATURE_UNKNOWN:
@@ -332,74 +839,100 @@ process_sensors_chip_name(IsLibsensorsPlugin *self,
 
     g_assert(chip_name_string && label);
 
-    /* ignore IO Errors since some chips report these sometimes
-       intermittently */
-    if ((ret = sensors_get_value(chip_name, input_feature->number, &value)) < 0 &&
-        ret != -SENSORS_ERR_IO)
-    {
-      is_warning("libsensors", "could not get value for input feature of sensor '%s': %s [%d]",
-                 chip_name_string, sensors_strerror(ret), ret);
-      free(label);
-      continue;
-    }
-
     path = g_strdup_printf(LIBSENSORS_PATH_PREFIX "/%s/%d",
                            chip_name_string,
                            input_feature->number);
-    if (main_feature->type == SENSORS_FEATURE_TEMP)
-    {
-      sensor = is_temperature_sensor_new(path);
-      is_sensor_set_icon(sensor, IS_STOCK_CPU);
-    }
-    else if (main_feature->type == SENSORS_FEATURE_FAN)
-    {
-      sensor = is_fan_sensor_new(path);
-      /* display fan readings to 0 decimal places like
-         sensors command */
-      is_sensor_set_digits(sensor, 0);
-    }
-    else
+    switch (main_feature->type)
     {
-      /* is a voltage sensor */
-      sensor = is_sensor_new(path);
-      /* display voltage readings to 2 decimal places like
-         sensors command */
-      is_sensor_set_digits(sensor, 2);
-      /* translators: V is the unit for Voltage, replace with
-         appropriate unit */
-      is_sensor_set_units(sensor, _("V"));
-      is_sensor_set_icon(sensor, IS_STOCK_CHIP);
+      case SENSORS_FEATURE_TEMP:
+        sensor = is_temperature_sensor_new(path);
+        is_sensor_set_icon(sensor, IS_STOCK_CPU);
+        break;
+
+      case SENSORS_FEATURE_FAN:
+        sensor = is_fan_sensor_new(path);
+        /* display fan readings to 0 decimal places like
+           sensors command */
+        is_sensor_set_digits(sensor, 0);
+        break;
+
+      case SENSORS_FEATURE_POWER:
+        sensor = is_power_sensor_new(path);
+        break;
+
+      case SENSORS_FEATURE_ENERGY:
+        /* shown as the power used between samples */
+        sensor = is_energy_sensor_new(path);
+        break;
+
+      case SENSORS_FEATURE_CURR:
+        sensor = is_current_sensor_new(path);
+        break;
+
+#if SENSORS_API_VERSION > 0x430
+      case SENSORS_FEATURE_HUMIDITY:
+        sensor = is_sensor_new(path);
+        is_sensor_set_digits(sensor, 1);
+        /* translators: %RH is the unit for relative humidity, replace
+           with appropriate unit */
+        is_sensor_set_units(sensor, _("%RH"));
+        is_sensor_set_icon(sensor, IS_STOCK_CASE);
+        break;
+
+      case SENSORS_FEATURE_INTRUSION:
+        /* 1 once the case has been opened */
+        sensor = is_sensor_new(path);
+        is_sensor_set_digits(sensor, 0);
+        is_sensor_set_icon(sensor, IS_STOCK_CASE);
+        is_sensor_set_alarm_value(sensor, 1.0);
+        is_sensor_set_alarm_mode(sensor, IS_SENSOR_ALARM_MODE_HIGH);
+        break;
+#endif
+
+      default:
+        /* is a voltage sensor */
+        sensor = is_sensor_new(path);
+        /* display voltage readings to 2 decimal places like
+           sensors command */
+        is_sensor_set_digits(sensor, 2);
+        /* translators: V is the unit for Voltage, replace with
+           appropriate unit */
+        is_sensor_set_units(sensor, _("V"));
+        is_sensor_set_icon(sensor, IS_STOCK_CHIP);
+        break;
     }
     is_sensor_set_label(sensor, label);
-    if (min_feature &&
-        sensors_get_value(chip_name, min_feature->number, &min) == 0)
-    {
-      is_sensor_set_alarm_mode(sensor, IS_SENSOR_ALARM_MODE_LOW);
-      is_sensor_set_alarm_value(sensor, min);
-      if (main_feature->type == SENSORS_FEATURE_TEMP)
-      {
-        is_sensor_set_low_value(sensor, min);
-      }
-    }
-    if (max_feature &&
-        sensors_get_value(chip_name, max_feature->number, &max) == 0)
+
+    /* values and limits are read on demand once the sensor is enabled or
+     * its dialog opened, so activation doesn't have to wait for every
+     * chip */
+    binding = g_slice_new0(LibsensorsBinding);
+    binding->chip = chip;
+    binding->sensor = sensor;
+    binding->nr = input_feature->number;
+    binding->temperature = (main_feature->type == SENSORS_FEATURE_TEMP);
+    binding->energy = (main_feature->type == SENSORS_FEATURE_ENERGY);
+    binding->min_nr = min_feature ? min_feature->number : -1;
+    binding->max_nr = max_feature ? max_feature->number : -1;
+    /* nothing applied yet so start from the defaults of the sensor */
+    binding->applied_alarm_mode = is_sensor_get_alarm_mode(sensor);
+    binding->applied_alarm_value = is_sensor_get_alarm_value(sensor);
+    binding->applied_low_value = is_sensor_get_low_value(sensor);
+    binding->applied_high_value = is_sensor_get_high_value(sensor);
+    /* connect to update-value signal - binding is freed along with the
+     * handler */
+    g_signal_connect_data(sensor, "update-value",
+                          G_CALLBACK(update_sensor_value),
+                          binding, (GClosureNotify)libsensors_binding_free, 0);
+    g_signal_connect(sensor, "request-limits",
+                     G_CALLBACK(request_sensor_limits), binding);
+    if (is_manager_add_sensor(is_application_get_manager(priv->application),
+                              sensor))
     {
-      is_sensor_set_alarm_mode(sensor, IS_SENSOR_ALARM_MODE_HIGH);
-      is_sensor_set_alarm_value(sensor, max);
-      if (main_feature->type == SENSORS_FEATURE_TEMP)
-      {
-        is_sensor_set_high_value(sensor, max);
-      }
+      priv->n_sensors++;
     }
-
-    /* take ownership of path pointer */
-    g_hash_table_insert(priv->sensor_chip_names, path, (void *)chip_name);
-    /* connect to update-value signal */
-    g_signal_connect(sensor, "update-value",
-                     G_CALLBACK(update_sensor_value),
-                     self);
-    is_manager_add_sensor(is_application_get_manager(priv->application),
-                          sensor);
+    g_object_unref(sensor);
+    g_free(path);
     free(label);
   }
   g_free(chip_name_string);
@@ -407,12 +940,29 @@ out:
   return;
 }
 
+static gboolean
+chip_is_owned(const sensors_chip_name *chip_name)
+{
+  gboolean ret = FALSE;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS(owned_chips); i++)
+  {
+    if (g_strcmp0(chip_name->prefix, owned_chips[i]) == 0)
+    {
+      ret = TRUE;
+    }
+  }
+  return ret;
+}
+
 static void
 is_libsensors_plugin_activate(PeasActivatable *activatable)
 {
   IsLibsensorsPlugin *self = IS_LIBSENSORS_PLUGIN(activatable);
   IsLibsensorsPluginPrivate *priv = self->priv;
   const sensors_chip_name *chip_name;
+  guint n_owned = 0;
   int nr = 0;
 
   /* search for sensors and add them to manager */
@@ -424,11 +974,21 @@ is_libsensors_plugin_activate(PeasActivatable *activatable)
   is_debug("libsensors", "searching for sensors");
   while ((chip_name = sensors_get_detected_chips(NULL, &nr)))
   {
+    if (chip_is_owned(chip_name))
+    {
+      is_debug("libsensors", "ignoring chip %s as it is read by another plugin",
+               chip_name->prefix);
+      n_owned++;
+      continue;
+    }
     process_sensors_chip_name(self, chip_name);
   }
+  g_signal_connect(priv->application,
+                   "update-values::" LIBSENSORS_PATH_PREFIX,
+                   G_CALLBACK(update_values), self);
   /* if we couldn't find any sensors then show a notification to tell the
    * user to try and run sensors-detect from the command line */
-  if (!g_hash_table_size(priv->sensor_chip_names))
+  if (!priv->n_sensors && !n_owned)
   {
     is_notify(IS_NOTIFY_LEVEL_INFO,
               _("No Sensors Detected"),
@@ -444,9 +1004,34 @@ is_libsensors_plugin_deactivate(PeasActivatable *activatable)
   IsLibsensorsPlugin *plugin = IS_LIBSENSORS_PLUGIN(activatable);
   IsLibsensorsPluginPrivate *priv = plugin->priv;
   IsManager *manager;
+  GHashTableIter iter;
+  LibsensorsChip *chip;
 
+  g_signal_handlers_disconnect_by_func(priv->application, update_values,
+                                       plugin);
+  if (priv->dispatch_id)
+  {
+    g_source_remove(priv->dispatch_id);
+    priv->dispatch_id = 0;
+  }
+  /* drop anything still waiting to be sampled - in flight samples are
+   * published (and their sensors released) when they complete */
+  g_hash_table_iter_init(&iter, priv->chips);
+  while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&chip))
+  {
+    guint i;
+
+    for (i = 0; i < chip->pending->len; i++)
+    {
+      LibsensorsBinding *binding = g_ptr_array_index(chip->pending, i);
+      binding->queued = FALSE;
+      g_object_unref(binding->sensor);
+    }
+    g_ptr_array_set_size(chip->pending, 0);
+  }
   manager = is_application_get_manager(priv->application);
   is_manager_remove_paths_with_prefix(manager, LIBSENSORS_PATH_PREFIX);
+  priv->n_sensors = 0;
 }
 
 static void
@@ -461,6 +1046,13 @@ is_libsensors_plugin_class_init(IsLibsensorsPluginClass *klass)
   gobject_class->finalize = is_libsensors_plugin_finalize;
 
   g_object_class_override_property(gobject_class, PROP_OBJECT, "object");
+  g_object_class_install_property(gobject_class, PROP_CHIP_TIMEOUT,
+                                  g_param_spec_uint("chip-timeout",
+                                                    "chip-timeout property",
+                                                    "Milliseconds a chip can take to be sampled before its sensors are marked as in error, or 0 to never time out.",
+                                                    0, G_MAXUINT,
+                                                    DEFAULT_CHIP_TIMEOUT,
+                                                    G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -21,8 +21,10 @@
 
 #include "is-nvidia-plugin.h"
 #include <stdlib.h>
+#include <gmodule.h>
 #include <indicator-sensors/is-temperature-sensor.h>
 #include <indicator-sensors/is-fan-sensor.h>
+#include <indicator-sensors/is-power-sensor.h>
 #include <indicator-sensors/is-application.h>
 #include <indicator-sensors/is-log.h>
 #include <X11/Xlib.h>
@@ -31,6 +33,17 @@
 #include <glib/gi18n.h>
 
 #define NVIDIA_PATH_PREFIX "nvidia"
+/* NVML is loaded at runtime so we can build and run without it */
+#define NVML_LIBRARY "libnvidia-ml.so.1"
+#define NVML_NAME_BUFFER_SIZE 96
+
+/* the subset of nvml.h we use */
+typedef int nvmlReturn_t;
+typedef struct nvmlDevice_st *nvmlDevice_t;
+#define NVML_SUCCESS 0
+#define NVML_TEMPERATURE_GPU 0
+#define NVML_CLOCK_GRAPHICS 0
+#define NVML_CLOCK_MEM 2
 
 static void peas_activatable_iface_init(PeasActivatableInterface *iface);
 
@@ -46,6 +59,27 @@ enum
   PROP_OBJECT = 1,
 };
 
+typedef struct
+{
+  GModule *module;
+  nvmlReturn_t (*init)(void);
+  nvmlReturn_t (*shutdown)(void);
+  const char *(*error_string)(nvmlReturn_t result);
+  nvmlReturn_t (*device_get_count)(unsigned int *count);
+  nvmlReturn_t (*device_get_handle_by_index)(unsigned int index,
+      nvmlDevice_t *device);
+  nvmlReturn_t (*device_get_name)(nvmlDevice_t device, char *name,
+                                  unsigned int length);
+  nvmlReturn_t (*device_get_temperature)(nvmlDevice_t device, int sensor,
+                                         unsigned int *temp);
+  nvmlReturn_t (*device_get_fan_speed)(nvmlDevice_t device,
+                                       unsigned int *speed);
+  nvmlReturn_t (*device_get_power_usage)(nvmlDevice_t device,
+                                         unsigned int *power);
+  nvmlReturn_t (*device_get_clock_info)(nvmlDevice_t device, int type,
+                                        unsigned int *clock);
+} Nvml;
+
 struct _IsNvidiaPluginPrivate
 {
   IsApplication *application;
@@ -53,6 +87,17 @@ struct _IsNvidiaPluginPrivate
 
   gboolean inited;
   GHashTable *sensor_chip_names;
+
+  /* NVML is used in preference to NV-CONTROL when available - all reads
+   * are then done on a single worker thread */
+  Nvml nvml;
+  gboolean nvml_inited;
+  GThreadPool *pool;
+  /* bindings due to be read by the next task and those being read by the
+   * one in flight */
+  GPtrArray *pending;
+  GPtrArray *sampling;
+  gboolean busy;
 };
 
 static void is_nvidia_plugin_finalize(GObject *object);
@@ -105,11 +150,8 @@ is_nvidia_plugin_init(IsNvidiaPlugin *self)
                                 IsNvidiaPluginPrivate);
 
   self->priv = priv;
-  priv->display = XOpenDisplay(NULL);
-  if (priv->display != NULL)
-  {
-    priv->inited = TRUE;
-  }
+  priv->pending = g_ptr_array_new();
+  priv->sampling = g_ptr_array_new();
 }
 
 static void
@@ -118,6 +160,26 @@ is_nvidia_plugin_finalize(GObject *object)
   IsNvidiaPlugin *self = (IsNvidiaPlugin *)object;
   IsNvidiaPluginPrivate *priv = self->priv;
 
+  /* a task in flight holds a reference on us so there is nothing left to
+   * wait for */
+  g_assert(!priv->busy);
+  if (priv->pool)
+  {
+    g_thread_pool_free(priv->pool, FALSE, TRUE);
+    priv->pool = NULL;
+  }
+  g_ptr_array_free(priv->sampling, TRUE);
+  g_ptr_array_free(priv->pending, TRUE);
+  if (priv->nvml_inited)
+  {
+    priv->nvml.shutdown();
+    priv->nvml_inited = FALSE;
+  }
+  if (priv->nvml.module)
+  {
+    g_module_close(priv->nvml.module);
+    priv->nvml.module = NULL;
+  }
   /* think about storing this in the class structure so we only init once
      and unload once */
   if (priv->inited)
@@ -125,6 +187,11 @@ is_nvidia_plugin_finalize(GObject *object)
     XCloseDisplay(priv->display);
     priv->inited = FALSE;
   }
+  if (priv->application)
+  {
+    g_object_unref(priv->application);
+    priv->application = NULL;
+  }
   G_OBJECT_CLASS(is_nvidia_plugin_parent_class)->finalize(object);
 }
 
@@ -172,65 +239,491 @@ static const struct map_entry map[] =
 #endif
 };
 
+/* bound to each sensor at creation as the user data of its update-value
+ * handler so reading a value needs no lookup in map or parsing of its
+ * path */
+typedef struct
+{
+  IsNvidiaPlugin *plugin;
+  gint target;
+  gint idx;
+  gint attribute;
+} NvidiaBinding;
+
+static void
+nvidia_binding_free(NvidiaBinding *binding,
+                    GClosure *closure)
+{
+  g_slice_free(NvidiaBinding, binding);
+}
+
 static void
 update_sensor_value(IsSensor *sensor,
-                    IsNvidiaPlugin *self)
+                    NvidiaBinding *binding)
+{
+  IsNvidiaPluginPrivate *priv = binding->plugin->priv;
+  Bool ret;
+  int value;
+
+  ret = XNVCTRLQueryTargetAttribute(priv->display,
+                                    binding->target,
+                                    binding->idx,
+                                    0,
+                                    binding->attribute,
+                                    &value);
+  if (!ret)
+  {
+    GError *error = g_error_new(g_quark_from_string("nvidia-plugin-error-quark"),
+                                0,
+                                /* first placeholder is
+                                 * sensor name */
+                                _("Error getting sensor value for sensor %s"),
+                                is_sensor_get_label(sensor));
+    is_sensor_set_error(sensor, error->message);
+    g_error_free(error);
+    goto out;
+  }
+  if (IS_IS_TEMPERATURE_SENSOR(sensor))
+  {
+    is_temperature_sensor_set_celsius_value(IS_TEMPERATURE_SENSOR(sensor),
+                                            value);
+  }
+  else
+  {
+    is_sensor_set_value(sensor, value);
+  }
+  is_sensor_set_error(sensor, NULL);
+
+out:
+  return;
+}
+
+typedef enum
+{
+  NVML_SENSOR_TEMPERATURE = 0,
+  NVML_SENSOR_FAN,
+  NVML_SENSOR_POWER,
+  NVML_SENSOR_GRAPHICS_CLOCK,
+  NVML_SENSOR_MEMORY_CLOCK,
+  NUM_NVML_SENSORS,
+} NvmlSensor;
+
+/* last component of the path of each type of NVML sensor */
+static const gchar *nvml_sensor_names[NUM_NVML_SENSORS] =
 {
-  IsNvidiaPluginPrivate *priv;
-  const gchar *path;
+  "Temp",
+  "Fan",
+  "Power",
+  "GraphicsClock",
+  "MemoryClock",
+};
+
+/* bound to each NVML sensor as the user data of its update-value handler */
+typedef struct
+{
+  IsNvidiaPlugin *plugin;
+  IsSensor *sensor;
+  nvmlDevice_t device;
+  NvmlSensor type;
+  /* whether in pending */
+  gboolean queued;
+  /* result of the last read, written on the worker thread */
+  unsigned int value;
+  nvmlReturn_t ret;
+} NvmlBinding;
+
+static void
+nvml_binding_free(NvmlBinding *binding,
+                  GClosure *closure)
+{
+  g_slice_free(NvmlBinding, binding);
+}
+
+static gboolean
+load_nvml(Nvml *nvml)
+{
+  static const struct
+  {
+    const gchar *name;
+    glong offset;
+  } symbols[] =
+  {
+    { "nvmlInit_v2", G_STRUCT_OFFSET(Nvml, init) },
+    { "nvmlShutdown", G_STRUCT_OFFSET(Nvml, shutdown) },
+    { "nvmlErrorString", G_STRUCT_OFFSET(Nvml, error_string) },
+    { "nvmlDeviceGetCount_v2", G_STRUCT_OFFSET(Nvml, device_get_count) },
+    { "nvmlDeviceGetHandleByIndex_v2", G_STRUCT_OFFSET(Nvml, device_get_handle_by_index) },
+    { "nvmlDeviceGetName", G_STRUCT_OFFSET(Nvml, device_get_name) },
+    { "nvmlDeviceGetTemperature", G_STRUCT_OFFSET(Nvml, device_get_temperature) },
+    { "nvmlDeviceGetFanSpeed", G_STRUCT_OFFSET(Nvml, device_get_fan_speed) },
+    { "nvmlDeviceGetPowerUsage", G_STRUCT_OFFSET(Nvml, device_get_power_usage) },
+    { "nvmlDeviceGetClockInfo", G_STRUCT_OFFSET(Nvml, device_get_clock_info) },
+  };
   guint i;
 
-  priv = self->priv;
+  nvml->module = g_module_open(NVML_LIBRARY,
+                               G_MODULE_BIND_LAZY | G_MODULE_BIND_LOCAL);
+  if (!nvml->module)
+  {
+    is_debug("nvidia", "unable to load %s: %s", NVML_LIBRARY,
+             g_module_error());
+    goto out;
+  }
+  for (i = 0; i < G_N_ELEMENTS(symbols); i++)
+  {
+    if (!g_module_symbol(nvml->module, symbols[i].name,
+                         (gpointer *)G_STRUCT_MEMBER_P(nvml, symbols[i].offset)))
+    {
+      is_warning("nvidia", "unable to find %s in %s: %s", symbols[i].name,
+                 NVML_LIBRARY, g_module_error());
+      g_module_close(nvml->module);
+      nvml->module = NULL;
+      goto out;
+    }
+  }
 
-  path = is_sensor_get_path(sensor);
+out:
+  return nvml->module != NULL;
+}
 
-  for (i = 0; i < G_N_ELEMENTS(map); i++)
+/* may be called on the worker thread */
+static nvmlReturn_t
+nvml_read(Nvml *nvml,
+          nvmlDevice_t device,
+          NvmlSensor type,
+          unsigned int *value)
+{
+  switch (type)
   {
-    Bool ret;
-    int value;
-    int idx;
-    if (g_strrstr(path, map[i].description) == NULL)
+    case NVML_SENSOR_TEMPERATURE:
+      return nvml->device_get_temperature(device, NVML_TEMPERATURE_GPU,
+                                          value);
+    case NVML_SENSOR_FAN:
+      return nvml->device_get_fan_speed(device, value);
+    case NVML_SENSOR_POWER:
+      return nvml->device_get_power_usage(device, value);
+    case NVML_SENSOR_GRAPHICS_CLOCK:
+      return nvml->device_get_clock_info(device, NVML_CLOCK_GRAPHICS, value);
+    case NVML_SENSOR_MEMORY_CLOCK:
+    default:
+      return nvml->device_get_clock_info(device, NVML_CLOCK_MEM, value);
+  }
+}
+
+static void
+publish_nvml_binding(IsNvidiaPlugin *self,
+                     NvmlBinding *binding)
+{
+  IsSensor *sensor = binding->sensor;
+
+  if (binding->ret != NVML_SUCCESS)
+  {
+    gchar *error = g_strdup_printf(/* first placeholder is sensor name,
+                                    * second is error message */
+                                   _("Error getting sensor value for sensor %s: %s"),
+                                   is_sensor_get_label(sensor),
+                                   self->priv->nvml.error_string(binding->ret));
+    is_sensor_set_error(sensor, error);
+    g_free(error);
+    goto out;
+  }
+  switch (binding->type)
+  {
+    case NVML_SENSOR_TEMPERATURE:
+      is_temperature_sensor_set_celsius_value(IS_TEMPERATURE_SENSOR(sensor),
+                                              binding->value);
+      break;
+
+    case NVML_SENSOR_POWER:
+      /* given in milliwatts */
+      is_sensor_set_value(sensor, binding->value / 1000.0);
+      break;
+
+    default:
+      is_sensor_set_value(sensor, binding->value);
+      break;
+  }
+  is_sensor_set_error(sensor, NULL);
+
+out:
+  return;
+}
+
+static gboolean
+publish_nvml_values(IsNvidiaPlugin *self)
+{
+  IsNvidiaPluginPrivate *priv = self->priv;
+  guint i;
+
+  for (i = 0; i < priv->sampling->len; i++)
+  {
+    NvmlBinding *binding = g_ptr_array_index(priv->sampling, i);
+    is_sensor_freeze_changed(binding->sensor);
+    publish_nvml_binding(self, binding);
+    is_sensor_thaw_changed(binding->sensor);
+    /* drop reference taken when queued */
+    g_object_unref(binding->sensor);
+  }
+  g_ptr_array_set_size(priv->sampling, 0);
+  priv->busy = FALSE;
+  return FALSE;
+}
+
+/* called on the worker thread */
+static void
+sample_nvml(IsNvidiaPlugin *self,
+            gpointer user_data)
+{
+  IsNvidiaPluginPrivate *priv = self->priv;
+  guint i;
+
+  for (i = 0; i < priv->sampling->len; i++)
+  {
+    NvmlBinding *binding = g_ptr_array_index(priv->sampling, i);
+    binding->ret = nvml_read(&priv->nvml, binding->device, binding->type,
+                             &binding->value);
+  }
+  /* hands the reference taken in dispatch_nvml() to the idle */
+  g_idle_add_full(G_PRIORITY_DEFAULT_IDLE, (GSourceFunc)publish_nvml_values,
+                  self, g_object_unref);
+}
+
+static void
+dispatch_nvml(IsNvidiaPlugin *self)
+{
+  IsNvidiaPluginPrivate *priv = self->priv;
+  GPtrArray *sampling;
+  guint i;
+
+  g_assert(!priv->busy);
+
+  /* swap so anything which becomes due while this task is in flight gets
+   * queued for the next one */
+  sampling = priv->sampling;
+  priv->sampling = priv->pending;
+  priv->pending = sampling;
+  for (i = 0; i < priv->sampling->len; i++)
+  {
+    NvmlBinding *binding = g_ptr_array_index(priv->sampling, i);
+    binding->queued = FALSE;
+  }
+  priv->busy = TRUE;
+  /* task holds a reference on us until its results are published */
+  g_thread_pool_push(priv->pool, g_object_ref(self), NULL);
+}
+
+static void
+nvml_update_sensor_value(IsSensor *sensor,
+                         NvmlBinding *binding)
+{
+  /* just queue - all due sensors are read together from
+   * nvml_update_values() */
+  if (!binding->queued)
+  {
+    binding->queued = TRUE;
+    /* keep sensor alive until its value is published */
+    g_object_ref(sensor);
+    g_ptr_array_add(binding->plugin->priv->pending, binding);
+  }
+}
+
+static void
+nvml_update_values(IsApplication *application,
+                   GPtrArray *sensors,
+                   IsNvidiaPlugin *self)
+{
+  IsNvidiaPluginPrivate *priv = self->priv;
+
+  /* if the last read is still in flight then whatever is due now just
+   * waits for the next tick */
+  if (!priv->busy && priv->pending->len > 0)
+  {
+    dispatch_nvml(self);
+  }
+}
+
+static IsSensor *
+nvml_sensor_new(const gchar *path,
+                const gchar *name,
+                NvmlSensor type)
+{
+  IsSensor *sensor;
+  gchar *label = NULL;
+
+  switch (type)
+  {
+    case NVML_SENSOR_TEMPERATURE:
+      sensor = is_temperature_sensor_new(path);
+      break;
+
+    case NVML_SENSOR_FAN:
+      /* fan speed is given as a percentage from 0 to 100 */
+      sensor = is_sensor_new(path);
+      is_sensor_set_icon(sensor, IS_STOCK_FAN);
+      is_sensor_set_units(sensor, "%");
+      is_sensor_set_low_value(sensor, 0.0);
+      is_sensor_set_high_value(sensor, 100.0);
+      /* translators: first placeholder is the name of the GPU */
+      label = g_strdup_printf(_("%s Fan"), name);
+      break;
+
+    case NVML_SENSOR_POWER:
+      sensor = is_power_sensor_new(path);
+      /* translators: first placeholder is the name of the GPU */
+      label = g_strdup_printf(_("%s Power"), name);
+      break;
+
+    case NVML_SENSOR_GRAPHICS_CLOCK:
+    case NVML_SENSOR_MEMORY_CLOCK:
+    default:
+      sensor = is_sensor_new(path);
+      /* translators: MHz is the unit for clock frequency in megahertz */
+      is_sensor_set_units(sensor, _(" MHz"));
+      label = g_strdup_printf(type == NVML_SENSOR_GRAPHICS_CLOCK ?
+                              /* translators: first placeholder is the
+                               * name of the GPU */
+                              _("%s Graphics Clock") :
+                              /* translators: first placeholder is the
+                               * name of the GPU */
+                              _("%s Memory Clock"),
+                              name);
+      break;
+  }
+  if (type != NVML_SENSOR_FAN)
+  {
+    is_sensor_set_icon(sensor, IS_STOCK_GPU);
+  }
+  if (type != NVML_SENSOR_POWER)
+  {
+    /* no decimal places to display */
+    is_sensor_set_digits(sensor, 0);
+  }
+  is_sensor_set_label(sensor, label ? label : name);
+  g_free(label);
+  return sensor;
+}
+
+/* GPU temperature and fan keep the paths NV-CONTROL gives them so existing
+ * config for them still applies - these index thermal sensors and coolers
+ * rather than GPUs but there is one of each per GPU in the common case */
+static gchar *
+nvml_sensor_path(unsigned int gpu,
+                 NvmlSensor type)
+{
+  switch (type)
+  {
+    case NVML_SENSOR_TEMPERATURE:
+      /* first entry of map is always the GPU temperature */
+      return g_strdup_printf(NVIDIA_PATH_PREFIX "/%s%u", map[0].description,
+                             gpu);
+    case NVML_SENSOR_FAN:
+      return g_strdup_printf(NVIDIA_PATH_PREFIX "/Fan%u", gpu);
+    default:
+      return g_strdup_printf(NVIDIA_PATH_PREFIX "/GPU%u/%s", gpu,
+                             nvml_sensor_names[type]);
+  }
+}
+
+/* returns TRUE if NVML is available and found any sensors */
+static gboolean
+activate_nvml(IsNvidiaPlugin *self)
+{
+  IsNvidiaPluginPrivate *priv = self->priv;
+  Nvml *nvml = &priv->nvml;
+  nvmlReturn_t ret;
+  unsigned int n, i;
+  guint n_sensors = 0;
+
+  if (!nvml->module && !load_nvml(nvml))
+  {
+    goto out;
+  }
+  if (!priv->nvml_inited)
+  {
+    ret = nvml->init();
+    if (ret != NVML_SUCCESS)
     {
-      continue;
+      is_warning("nvidia", "unable to initialise NVML: %s",
+                 nvml->error_string(ret));
+      goto out;
     }
-    idx = g_ascii_strtoll(g_strrstr(path, map[i].description) +
-                          strlen(map[i].description), NULL, 10);
-
-    ret = XNVCTRLQueryTargetAttribute(priv->display,
-                                      map[i].target,
-                                      idx,
-                                      0,
-                                      map[i].attribute,
-                                      &value);
-    if (!ret)
+    priv->nvml_inited = TRUE;
+  }
+  ret = nvml->device_get_count(&n);
+  if (ret != NVML_SUCCESS)
+  {
+    is_warning("nvidia", "unable to get number of GPUs from NVML: %s",
+               nvml->error_string(ret));
+    goto out;
+  }
+  is_debug("nvidia", "searching for sensors using NVML");
+  for (i = 0; i < n; i++)
+  {
+    nvmlDevice_t device;
+    char name[NVML_NAME_BUFFER_SIZE];
+    NvmlSensor type;
+
+    if (nvml->device_get_handle_by_index(i, &device) != NVML_SUCCESS)
     {
-      GError *error = g_error_new(g_quark_from_string("nvidia-plugin-error-quark"),
-                                  0,
-                                  /* first placeholder is
-                                   * sensor name */
-                                  _("Error getting sensor value for sensor %s"),
-                                  is_sensor_get_label(sensor));
-      is_sensor_set_error(sensor, error->message);
-      g_error_free(error);
       continue;
     }
-    if (IS_IS_TEMPERATURE_SENSOR(sensor))
+    if (nvml->device_get_name(device, name, sizeof(name)) != NVML_SUCCESS)
     {
-      is_temperature_sensor_set_celsius_value(IS_TEMPERATURE_SENSOR(sensor),
-                                              value);
+      g_snprintf(name, sizeof(name), "GPU%u", i);
+    }
+    for (type = 0; type < NUM_NVML_SENSORS; type++)
+    {
+      NvmlBinding *binding;
+      IsSensor *sensor;
+      unsigned int value;
+      gchar *path;
+
+      /* not all GPUs support every type of reading */
+      if (nvml_read(nvml, device, type, &value) != NVML_SUCCESS)
+      {
+        continue;
+      }
+      path = nvml_sensor_path(i, type);
+      sensor = nvml_sensor_new(path, name, type);
+      g_free(path);
+
+      binding = g_slice_new0(NvmlBinding);
+      binding->plugin = self;
+      binding->sensor = sensor;
+      binding->device = device;
+      binding->type = type;
+      /* binding is freed along with the handler */
+      g_signal_connect_data(sensor, "update-value",
+                            G_CALLBACK(nvml_update_sensor_value),
+                            binding, (GClosureNotify)nvml_binding_free, 0);
+      if (is_manager_add_sensor(is_application_get_manager(priv->application),
+                                sensor))
+      {
+        n_sensors++;
+      }
+      g_object_unref(sensor);
     }
-    else
+  }
+  if (n_sensors > 0)
+  {
+    if (!priv->pool)
     {
-      is_sensor_set_value(sensor, value);
+      /* NVML reads are serialised on a single thread */
+      priv->pool = g_thread_pool_new((GFunc)sample_nvml, NULL, 1, FALSE,
+                                     NULL);
     }
-    is_sensor_set_error(sensor, NULL);
+    g_signal_connect(priv->application,
+                     "update-values::" NVIDIA_PATH_PREFIX,
+                     G_CALLBACK(nvml_update_values), self);
   }
+
+out:
+  return n_sensors > 0;
 }
 
 static void
-is_nvidia_plugin_activate(PeasActivatable *activatable)
+activate_nv_control(IsNvidiaPlugin *self)
 {
-  IsNvidiaPlugin *self = IS_NVIDIA_PLUGIN(activatable);
   IsNvidiaPluginPrivate *priv = self->priv;
   Bool ret;
   int event_base, error_base;
@@ -330,6 +823,7 @@ is_nvidia_plugin_activate(PeasActivatable *activatable)
         int32_t idx = data[k];
         gint value;
         IsSensor *sensor;
+        NvidiaBinding *binding;
         gchar *path;
 
         /* if we are using the old API, requery for GPU
@@ -383,12 +877,19 @@ is_nvidia_plugin_activate(PeasActivatable *activatable)
         /* no decimal places to display */
         is_sensor_set_digits(sensor, 0);
         is_sensor_set_label(sensor, label);
-        /* connect to update-value signal */
-        g_signal_connect(sensor, "update-value",
-                         G_CALLBACK(update_sensor_value),
-                         self);
+        binding = g_slice_new(NvidiaBinding);
+        binding->plugin = self;
+        binding->target = map[j].target;
+        binding->idx = idx;
+        binding->attribute = map[j].attribute;
+        /* connect to update-value signal - binding is freed along with the
+         * handler */
+        g_signal_connect_data(sensor, "update-value",
+                              G_CALLBACK(update_sensor_value),
+                              binding, (GClosureNotify)nvidia_binding_free, 0);
         is_manager_add_sensor(is_application_get_manager(priv->application),
                               sensor);
+        g_object_unref(sensor);
         g_free(path);
       }
       free(data);
@@ -400,13 +901,47 @@ out:
   return;
 }
 
+static void
+is_nvidia_plugin_activate(PeasActivatable *activatable)
+{
+  IsNvidiaPlugin *self = IS_NVIDIA_PLUGIN(activatable);
+  IsNvidiaPluginPrivate *priv = self->priv;
+
+  if (activate_nvml(self))
+  {
+    goto out;
+  }
+  /* fall back to NV-CONTROL which needs an X display */
+  if (!priv->inited)
+  {
+    priv->display = XOpenDisplay(NULL);
+    priv->inited = (priv->display != NULL);
+  }
+  activate_nv_control(self);
+
+out:
+  return;
+}
+
 static void
 is_nvidia_plugin_deactivate(PeasActivatable *activatable)
 {
   IsNvidiaPlugin *plugin = IS_NVIDIA_PLUGIN(activatable);
   IsNvidiaPluginPrivate *priv = plugin->priv;
   IsManager *manager;
+  guint i;
 
+  g_signal_handlers_disconnect_by_func(priv->application, nvml_update_values,
+                                       plugin);
+  /* drop anything still waiting to be read - a read in flight is
+   * published (and its sensors released) when it completes */
+  for (i = 0; i < priv->pending->len; i++)
+  {
+    NvmlBinding *binding = g_ptr_array_index(priv->pending, i);
+    binding->queued = FALSE;
+    g_object_unref(binding->sensor);
+  }
+  g_ptr_array_set_size(priv->pending, 0);
   manager = is_application_get_manager(priv->application);
   is_manager_remove_paths_with_prefix(manager, NVIDIA_PATH_PREFIX);
 }
@@ -0,0 +1,319 @@
+/*
+ * Copyright (C) 2011-2019 Alex Murray <murray.alex@gmail.com>
+ *
+ * indicator-sensors is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * indicator-sensors is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with indicator-sensors.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "is-rapl-plugin.h"
+#include <errno.h>
+#include <string.h>
+#include <indicator-sensors/is-energy-sensor.h>
+#include <indicator-sensors/is-application.h>
+#include <indicator-sensors/is-sysfs.h>
+#include <indicator-sensors/is-log.h>
+#include <glib/gi18n.h>
+
+#define RAPL_PATH_PREFIX "rapl"
+#define POWERCAP_CLASS_DIR "/sys/class/powercap"
+
+static void peas_activatable_iface_init(PeasActivatableInterface *iface);
+
+G_DEFINE_DYNAMIC_TYPE_EXTENDED(IsRaplPlugin,
+                               is_rapl_plugin,
+                               PEAS_TYPE_EXTENSION_BASE,
+                               0,
+                               G_IMPLEMENT_INTERFACE_DYNAMIC(PEAS_TYPE_ACTIVATABLE,
+                                   peas_activatable_iface_init));
+
+enum
+{
+  PROP_OBJECT = 1,
+};
+
+struct _IsRaplPluginPrivate
+{
+  IsApplication *application;
+};
+
+static void is_rapl_plugin_finalize(GObject *object);
+
+static void
+is_rapl_plugin_set_property(GObject *object,
+                            guint prop_id,
+                            const GValue *value,
+                            GParamSpec *pspec)
+{
+  IsRaplPlugin *plugin = IS_RAPL_PLUGIN(object);
+
+  switch (prop_id)
+  {
+    case PROP_OBJECT:
+      plugin->priv->application = IS_APPLICATION(g_value_dup_object(value));
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+is_rapl_plugin_get_property(GObject *object,
+                            guint prop_id,
+                            GValue *value,
+                            GParamSpec *pspec)
+{
+  IsRaplPlugin *plugin = IS_RAPL_PLUGIN(object);
+
+  switch (prop_id)
+  {
+    case PROP_OBJECT:
+      g_value_set_object(value, plugin->priv->application);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+is_rapl_plugin_init(IsRaplPlugin *self)
+{
+  IsRaplPluginPrivate *priv =
+    G_TYPE_INSTANCE_GET_PRIVATE(self, IS_TYPE_RAPL_PLUGIN,
+                                IsRaplPluginPrivate);
+
+  self->priv = priv;
+}
+
+static void
+is_rapl_plugin_finalize(GObject *object)
+{
+  IsRaplPlugin *self = IS_RAPL_PLUGIN(object);
+  IsRaplPluginPrivate *priv = self->priv;
+
+  if (priv->application)
+  {
+    g_object_unref(priv->application);
+    priv->application = NULL;
+  }
+  G_OBJECT_CLASS(is_rapl_plugin_parent_class)->finalize(object);
+}
+
+static void
+close_energy_fd(gpointer data,
+                GClosure *closure)
+{
+  is_sysfs_close(GPOINTER_TO_INT(data));
+}
+
+/* the fd of energy_uj is bound to each sensor as the user data for its
+ * update-value handler */
+static void
+update_sensor_value(IsSensor *sensor,
+                    gpointer data)
+{
+  gint64 energy;
+
+  if (!is_sysfs_read_int(GPOINTER_TO_INT(data), &energy))
+  {
+    const gchar *reason = g_strerror(errno);
+    gchar *error = g_strdup_printf(/* first placeholder is sensor name,
+                                    * second is error message */
+                                   _("Error getting sensor value for sensor %s: %s"),
+                                   is_sensor_get_path(sensor), reason);
+    is_sensor_set_error(sensor, error);
+    g_free(error);
+    goto out;
+  }
+  is_energy_sensor_set_energy(IS_ENERGY_SENSOR(sensor), (guint64)energy,
+                              g_get_monotonic_time());
+  is_sensor_set_error(sensor, NULL);
+
+out:
+  return;
+}
+
+/* subzones like core and dram are only named for themselves so prefix them
+ * with the name of the package they belong to - ie. intel-rapl:0:1 is
+ * within intel-rapl:0 */
+static gchar *
+get_zone_label(const gchar *zone,
+               const gchar *name)
+{
+  const gchar *first, *last;
+  gchar *label = NULL;
+
+  first = strchr(zone, ':');
+  last = strrchr(zone, ':');
+  if (first && last != first)
+  {
+    gchar *parent = g_strndup(zone, last - zone);
+    gchar *dir = g_build_filename(POWERCAP_CLASS_DIR, parent, NULL);
+    gchar *parent_name = is_sysfs_get_string(dir, "name");
+
+    if (parent_name && *parent_name)
+    {
+      label = g_strdup_printf("%s %s", parent_name, name);
+    }
+    g_free(parent_name);
+    g_free(dir);
+    g_free(parent);
+  }
+  return label ? label : g_strdup(name);
+}
+
+static void
+process_zone(IsRaplPlugin *self,
+             const gchar *zone)
+{
+  IsRaplPluginPrivate *priv = self->priv;
+  IsSensor *sensor;
+  gchar *dir, *name = NULL, *label, *path;
+  gint64 range, max_power;
+  gint fd;
+
+  dir = g_build_filename(POWERCAP_CLASS_DIR, zone, NULL);
+  /* control types like intel-rapl itself have no counter */
+  fd = is_sysfs_open(dir, "energy_uj");
+  if (fd < 0)
+  {
+    if (errno != ENOENT)
+    {
+      /* only readable by root on kernels since 5.10 */
+      is_debug("rapl", "could not open energy counter for zone %s: %s",
+               zone, g_strerror(errno));
+    }
+    goto out;
+  }
+  name = is_sysfs_get_string(dir, "name");
+  if (!name || !*name)
+  {
+    g_free(name);
+    name = g_strdup(zone);
+  }
+
+  path = g_strdup_printf(RAPL_PATH_PREFIX "/%s", zone);
+  sensor = is_energy_sensor_new(path);
+  g_free(path);
+  is_sensor_set_icon(sensor, g_str_has_prefix(name, "dram") ?
+                     IS_STOCK_MEMORY : IS_STOCK_CPU);
+  label = get_zone_label(zone, name);
+  is_sensor_set_label(sensor, label);
+  g_free(label);
+  if (is_sysfs_get_int(dir, "max_energy_range_uj", &range) && range > 0)
+  {
+    is_energy_sensor_set_max_energy_range(IS_ENERGY_SENSOR(sensor),
+                                          (guint64)range);
+  }
+  /* range of the sensor is up to the maximum the zone allows, if known */
+  if (is_sysfs_get_int(dir, "constraint_0_max_power_uw", &max_power) &&
+      max_power > 0)
+  {
+    is_sensor_set_high_value(sensor, (gdouble)max_power / 1000000.0);
+  }
+
+  /* fd is closed along with the handler when the sensor is freed */
+  g_signal_connect_data(sensor, "update-value",
+                        G_CALLBACK(update_sensor_value),
+                        GINT_TO_POINTER(fd), close_energy_fd, 0);
+  is_manager_add_sensor(is_application_get_manager(priv->application),
+                        sensor);
+  g_object_unref(sensor);
+
+out:
+  g_free(name);
+  g_free(dir);
+}
+
+static void
+is_rapl_plugin_activate(PeasActivatable *activatable)
+{
+  IsRaplPlugin *self = IS_RAPL_PLUGIN(activatable);
+  const gchar *entry;
+  GDir *dir;
+  GError *error = NULL;
+
+  /* each zone keeps its energy counter open for the lifetime of its
+   * sensor */
+  dir = g_dir_open(POWERCAP_CLASS_DIR, 0, &error);
+  if (!dir)
+  {
+    is_debug("rapl", "unable to find sensors: %s", error->message);
+    g_error_free(error);
+    goto out;
+  }
+  is_debug("rapl", "searching for sensors");
+  while ((entry = g_dir_read_name(dir)) != NULL)
+  {
+    process_zone(self, entry);
+  }
+  g_dir_close(dir);
+
+out:
+  return;
+}
+
+static void
+is_rapl_plugin_deactivate(PeasActivatable *activatable)
+{
+  IsRaplPlugin *plugin = IS_RAPL_PLUGIN(activatable);
+  IsRaplPluginPrivate *priv = plugin->priv;
+  IsManager *manager;
+
+  manager = is_application_get_manager(priv->application);
+  is_manager_remove_paths_with_prefix(manager, RAPL_PATH_PREFIX);
+}
+
+static void
+is_rapl_plugin_class_init(IsRaplPluginClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+  g_type_class_add_private(klass, sizeof(IsRaplPluginPrivate));
+
+  gobject_class->get_property = is_rapl_plugin_get_property;
+  gobject_class->set_property = is_rapl_plugin_set_property;
+  gobject_class->finalize = is_rapl_plugin_finalize;
+
+  g_object_class_override_property(gobject_class, PROP_OBJECT, "object");
+}
+
+static void
+peas_activatable_iface_init(PeasActivatableInterface *iface)
+{
+  iface->activate = is_rapl_plugin_activate;
+  iface->deactivate = is_rapl_plugin_deactivate;
+}
+
+static void
+is_rapl_plugin_class_finalize(IsRaplPluginClass *klass)
+{
+  /* nothing to do */
+}
+
+G_MODULE_EXPORT void
+peas_register_types(PeasObjectModule *module)
+{
+  is_rapl_plugin_register_type(G_TYPE_MODULE(module));
+
+  peas_object_module_register_extension_type(module,
+      PEAS_TYPE_ACTIVATABLE,
+      IS_TYPE_RAPL_PLUGIN);
+}
@@ -0,0 +1,639 @@
+/*
+ * Copyright (C) 2011-2019 Alex Murray <murray.alex@gmail.com>
+ *
+ * indicator-sensors is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * indicator-sensors is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with indicator-sensors.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "is-storage-plugin.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#ifdef HAVE_LINUX_NVME_IOCTL_H
+#include <linux/nvme_ioctl.h>
+#endif
+#include <indicator-sensors/is-temperature-sensor.h>
+#include <indicator-sensors/is-application.h>
+#include <indicator-sensors/is-sysfs.h>
+#include <indicator-sensors/is-log.h>
+#include <glib/gi18n.h>
+
+#define STORAGE_PATH_PREFIX "storage"
+#define HWMON_CLASS_DIR "/sys/class/hwmon"
+#define NVME_CLASS_DIR "/sys/class/nvme"
+
+/* get log page admin command for the SMART / health information log,
+ * which is global to the controller */
+#define NVME_ADMIN_GET_LOG_PAGE 0x02
+#define NVME_LOG_SMART 0x02
+#define NVME_NSID_ALL 0xffffffff
+#define NVME_SMART_LOG_SIZE 512
+
+/* reading the temperature of a SATA / SAS drive sends it a command, which
+ * resets its spin-down timer, so don't do so too often by default - NVMe
+ * drives have no such timer so follow the application */
+#define DRIVETEMP_UPDATE_INTERVAL 60
+
+static void peas_activatable_iface_init(PeasActivatableInterface *iface);
+
+G_DEFINE_DYNAMIC_TYPE_EXTENDED(IsStoragePlugin,
+                               is_storage_plugin,
+                               PEAS_TYPE_EXTENSION_BASE,
+                               0,
+                               G_IMPLEMENT_INTERFACE_DYNAMIC(PEAS_TYPE_ACTIVATABLE,
+                                   peas_activatable_iface_init));
+
+enum
+{
+  PROP_OBJECT = 1,
+};
+
+struct _IsStoragePluginPrivate
+{
+  IsApplication *application;
+
+  /* every read sends a command to the drive (even via hwmon) and so can
+   * take as long as the drive wants - they are done on a single worker
+   * thread */
+  GThreadPool *pool;
+  /* bindings due to be read by the next task and those being read by the
+   * one in flight */
+  GPtrArray *pending;
+  GPtrArray *sampling;
+  gboolean busy;
+};
+
+/* bound to each sensor as the user data for its update-value handler -
+ * fd is either the temp1_input of a hwmon device or an NVMe controller
+ * character device to read the SMART log from */
+typedef struct
+{
+  IsStoragePlugin *plugin;
+  IsSensor *sensor;
+  gint fd;
+  gboolean hwmon;
+  /* whether in pending */
+  gboolean queued;
+  /* result of the last read, written on the worker thread - errsv is 0 on
+   * success */
+  gdouble celsius;
+  gint errsv;
+} StorageBinding;
+
+static void is_storage_plugin_finalize(GObject *object);
+
+static void
+is_storage_plugin_set_property(GObject *object,
+                               guint prop_id,
+                               const GValue *value,
+                               GParamSpec *pspec)
+{
+  IsStoragePlugin *plugin = IS_STORAGE_PLUGIN(object);
+
+  switch (prop_id)
+  {
+    case PROP_OBJECT:
+      plugin->priv->application = IS_APPLICATION(g_value_dup_object(value));
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+is_storage_plugin_get_property(GObject *object,
+                               guint prop_id,
+                               GValue *value,
+                               GParamSpec *pspec)
+{
+  IsStoragePlugin *plugin = IS_STORAGE_PLUGIN(object);
+
+  switch (prop_id)
+  {
+    case PROP_OBJECT:
+      g_value_set_object(value, plugin->priv->application);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+is_storage_plugin_init(IsStoragePlugin *self)
+{
+  IsStoragePluginPrivate *priv =
+    G_TYPE_INSTANCE_GET_PRIVATE(self, IS_TYPE_STORAGE_PLUGIN,
+                                IsStoragePluginPrivate);
+
+  self->priv = priv;
+  priv->pending = g_ptr_array_new();
+  priv->sampling = g_ptr_array_new();
+}
+
+static void
+is_storage_plugin_finalize(GObject *object)
+{
+  IsStoragePlugin *self = IS_STORAGE_PLUGIN(object);
+  IsStoragePluginPrivate *priv = self->priv;
+
+  /* a task in flight holds a reference on us */
+  g_assert(!priv->busy);
+  if (priv->pool)
+  {
+    g_thread_pool_free(priv->pool, FALSE, TRUE);
+    priv->pool = NULL;
+  }
+  g_ptr_array_free(priv->sampling, TRUE);
+  g_ptr_array_free(priv->pending, TRUE);
+  if (priv->application)
+  {
+    g_object_unref(priv->application);
+    priv->application = NULL;
+  }
+  G_OBJECT_CLASS(is_storage_plugin_parent_class)->finalize(object);
+}
+
+static void
+storage_binding_free(StorageBinding *binding,
+                     GClosure *closure)
+{
+  is_sysfs_close(binding->fd);
+  g_slice_free(StorageBinding, binding);
+}
+
+static void
+set_read_error(IsSensor *sensor,
+               gint errsv)
+{
+  gchar *error = g_strdup_printf(/* first placeholder is sensor name,
+                                  * second is error message */
+                                 _("Error getting sensor value for sensor %s: %s"),
+                                 is_sensor_get_path(sensor), g_strerror(errsv));
+  is_sensor_set_error(sensor, error);
+  g_free(error);
+}
+
+/* called on the worker thread - returns 0 or an errno value */
+static gint
+read_hwmon(gint fd,
+           gdouble *celsius)
+{
+  gint64 raw;
+
+  if (!is_sysfs_read_int(fd, &raw))
+  {
+    return errno;
+  }
+  /* millidegree Celsius */
+  *celsius = (gdouble)raw / 1000.0;
+  return 0;
+}
+
+#ifdef HAVE_LINUX_NVME_IOCTL_H
+/* called on the worker thread - returns 0 or an errno value */
+static gint
+read_smart_log(gint fd,
+               gdouble *celsius)
+{
+  struct nvme_admin_cmd cmd;
+  guint8 log[NVME_SMART_LOG_SIZE];
+  gint ret;
+
+  memset(&cmd, 0, sizeof(cmd));
+  memset(log, 0, sizeof(log));
+  cmd.opcode = NVME_ADMIN_GET_LOG_PAGE;
+  cmd.nsid = NVME_NSID_ALL;
+  cmd.addr = (guint64)(guintptr)log;
+  cmd.data_len = sizeof(log);
+  /* number of dwords to read less one, then the log page identifier */
+  cmd.cdw10 = ((sizeof(log) / 4 - 1) << 16) | NVME_LOG_SMART;
+  do
+  {
+    ret = ioctl(fd, NVME_IOCTL_ADMIN_CMD, &cmd);
+  }
+  while (ret < 0 && errno == EINTR);
+  if (ret < 0)
+  {
+    return errno;
+  }
+  /* positive is an NVMe status code */
+  if (ret > 0)
+  {
+    return EIO;
+  }
+  /* composite temperature is bytes 1 and 2 in kelvin */
+  *celsius = (gdouble)(log[1] | (log[2] << 8)) - 273.15;
+  return 0;
+}
+#endif
+
+static gboolean
+publish_values(IsStoragePlugin *self)
+{
+  IsStoragePluginPrivate *priv = self->priv;
+  guint i;
+
+  for (i = 0; i < priv->sampling->len; i++)
+  {
+    StorageBinding *binding = g_ptr_array_index(priv->sampling, i);
+    IsSensor *sensor = binding->sensor;
+
+    is_sensor_freeze_changed(sensor);
+    if (binding->errsv)
+    {
+      set_read_error(sensor, binding->errsv);
+    }
+    else
+    {
+      is_temperature_sensor_set_celsius_value(IS_TEMPERATURE_SENSOR(sensor),
+                                              binding->celsius);
+      is_sensor_set_error(sensor, NULL);
+    }
+    is_sensor_thaw_changed(sensor);
+    /* drop reference taken when queued */
+    g_object_unref(sensor);
+  }
+  g_ptr_array_set_size(priv->sampling, 0);
+  priv->busy = FALSE;
+  return FALSE;
+}
+
+/* called on the worker thread */
+static void
+sample_drives(IsStoragePlugin *self,
+              gpointer user_data)
+{
+  IsStoragePluginPrivate *priv = self->priv;
+  guint i;
+
+  for (i = 0; i < priv->sampling->len; i++)
+  {
+    StorageBinding *binding = g_ptr_array_index(priv->sampling, i);
+    if (binding->hwmon)
+    {
+      binding->errsv = read_hwmon(binding->fd, &binding->celsius);
+    }
+    else
+    {
+#ifdef HAVE_LINUX_NVME_IOCTL_H
+      binding->errsv = read_smart_log(binding->fd, &binding->celsius);
+#else
+      binding->errsv = ENOTSUP;
+#endif
+    }
+  }
+  /* hands the reference taken in update_values() to the idle */
+  g_idle_add_full(G_PRIORITY_DEFAULT_IDLE, (GSourceFunc)publish_values,
+                  self, g_object_unref);
+}
+
+static void
+update_sensor_value(IsSensor *sensor,
+                    StorageBinding *binding)
+{
+  /* just queue - all due sensors are read together from
+   * update_values() */
+  if (!binding->queued)
+  {
+    binding->queued = TRUE;
+    /* keep sensor alive until its value is published */
+    g_object_ref(sensor);
+    g_ptr_array_add(binding->plugin->priv->pending, binding);
+  }
+}
+
+static void
+update_values(IsApplication *application,
+              GPtrArray *sensors,
+              IsStoragePlugin *self)
+{
+  IsStoragePluginPrivate *priv = self->priv;
+  GPtrArray *sampling;
+  guint i;
+
+  /* if the last read is still in flight then whatever is due now just
+   * waits for the next tick */
+  if (priv->busy || priv->pending->len == 0)
+  {
+    return;
+  }
+  sampling = priv->sampling;
+  priv->sampling = priv->pending;
+  priv->pending = sampling;
+  for (i = 0; i < priv->sampling->len; i++)
+  {
+    StorageBinding *binding = g_ptr_array_index(priv->sampling, i);
+    binding->queued = FALSE;
+  }
+  priv->busy = TRUE;
+  /* task holds a reference on us until its results are published */
+  g_thread_pool_push(priv->pool, g_object_ref(self), NULL);
+}
+
+/* an update_interval of 0 leaves the sensor to follow the poll rate of the
+ * application */
+static void
+add_sensor(IsStoragePlugin *self,
+           const gchar *name,
+           const gchar *model,
+           gint fd,
+           const gchar *hwmon,
+           guint update_interval)
+{
+  IsStoragePluginPrivate *priv = self->priv;
+  StorageBinding *binding;
+  IsSensor *sensor;
+  gchar *path;
+  gint64 limit;
+
+  path = g_strdup_printf(STORAGE_PATH_PREFIX "/%s", name);
+  sensor = is_temperature_sensor_new(path);
+  g_free(path);
+  is_sensor_set_label(sensor, (model && *model) ? model : name);
+  is_sensor_set_digits(sensor, 0);
+  is_sensor_set_icon(sensor, IS_STOCK_DISK);
+  if (update_interval)
+  {
+    is_sensor_set_update_interval(sensor, update_interval);
+  }
+  if (hwmon)
+  {
+    if (is_sysfs_get_int(hwmon, "temp1_crit", &limit) && limit > 0)
+    {
+      is_sensor_set_alarm_mode(sensor, IS_SENSOR_ALARM_MODE_HIGH);
+      is_sensor_set_alarm_value(sensor, (gdouble)limit / 1000.0);
+    }
+    if (is_sysfs_get_int(hwmon, "temp1_max", &limit) && limit > 0)
+    {
+      is_sensor_set_high_value(sensor, (gdouble)limit / 1000.0);
+    }
+  }
+
+  if (!priv->pool)
+  {
+    priv->pool = g_thread_pool_new((GFunc)sample_drives, NULL, 1, FALSE,
+                                   NULL);
+  }
+  binding = g_slice_new0(StorageBinding);
+  binding->plugin = self;
+  binding->sensor = sensor;
+  binding->fd = fd;
+  binding->hwmon = (hwmon != NULL);
+  /* binding is freed along with the handler */
+  g_signal_connect_data(sensor, "update-value",
+                        G_CALLBACK(update_sensor_value),
+                        binding, (GClosureNotify)storage_binding_free, 0);
+  is_manager_add_sensor(is_application_get_manager(priv->application),
+                        sensor);
+  g_object_unref(sensor);
+}
+
+/* returns the path of the first hwmonN directory within dir if any */
+static gchar *
+find_hwmon(const gchar *dir)
+{
+  const gchar *entry;
+  gchar *hwmon = NULL;
+  GDir *gdir;
+
+  gdir = g_dir_open(dir, 0, NULL);
+  if (!gdir)
+  {
+    goto out;
+  }
+  while (!hwmon && (entry = g_dir_read_name(gdir)) != NULL)
+  {
+    if (g_str_has_prefix(entry, "hwmon"))
+    {
+      hwmon = g_build_filename(dir, entry, NULL);
+    }
+  }
+  g_dir_close(gdir);
+
+out:
+  return hwmon;
+}
+
+/* SATA / SAS drives with the drivetemp driver loaded have a hwmon device
+ * named drivetemp whose device is the SCSI disk */
+static void
+process_drivetemp(IsStoragePlugin *self,
+                  const gchar *entry)
+{
+  gchar *hwmon, *name, *device, *block = NULL, *model = NULL;
+  GDir *gdir;
+  gint fd;
+
+  hwmon = g_build_filename(HWMON_CLASS_DIR, entry, NULL);
+  name = is_sysfs_get_string(hwmon, "name");
+  if (g_strcmp0(name, "drivetemp") != 0)
+  {
+    goto out;
+  }
+  device = g_build_filename(hwmon, "device", NULL);
+  model = is_sysfs_get_string(device, "model");
+  /* name the sensor after the block device if there is one */
+  block = g_build_filename(device, "block", NULL);
+  g_free(device);
+  gdir = g_dir_open(block, 0, NULL);
+  g_free(block);
+  block = NULL;
+  if (gdir)
+  {
+    block = g_strdup(g_dir_read_name(gdir));
+    g_dir_close(gdir);
+  }
+
+  fd = is_sysfs_open(hwmon, "temp1_input");
+  if (fd < 0)
+  {
+    is_warning("storage", "could not open temperature of %s: %s",
+               entry, g_strerror(errno));
+    goto out;
+  }
+  add_sensor(self, block ? block : entry, model, fd, hwmon,
+             DRIVETEMP_UPDATE_INTERVAL);
+
+out:
+  g_free(model);
+  g_free(block);
+  g_free(name);
+  g_free(hwmon);
+}
+
+/* NVMe controllers have a hwmon device since linux 5.5 - otherwise fall
+ * back to reading the SMART log from the controller itself */
+static void
+process_nvme(IsStoragePlugin *self,
+             const gchar *entry)
+{
+  gchar *dir, *hwmon, *model;
+  gint fd;
+
+  dir = g_build_filename(NVME_CLASS_DIR, entry, NULL);
+  model = is_sysfs_get_string(dir, "model");
+  hwmon = find_hwmon(dir);
+  if (!hwmon)
+  {
+    /* older kernels put it on the PCI device instead */
+    gchar *device = g_build_filename(dir, "device", "hwmon", NULL);
+    hwmon = find_hwmon(device);
+    g_free(device);
+  }
+  if (hwmon)
+  {
+    /* temp1 is the composite temperature */
+    fd = is_sysfs_open(hwmon, "temp1_input");
+    if (fd < 0)
+    {
+      is_warning("storage", "could not open temperature of %s: %s",
+                 entry, g_strerror(errno));
+      goto out;
+    }
+    add_sensor(self, entry, model, fd, hwmon, 0);
+    goto out;
+  }
+
+#ifdef HAVE_LINUX_NVME_IOCTL_H
+  {
+    gchar *node = g_build_filename("/dev", entry, NULL);
+    do
+    {
+      fd = open(node, O_RDONLY | O_CLOEXEC);
+    }
+    while (fd < 0 && errno == EINTR);
+    g_free(node);
+  }
+  if (fd < 0)
+  {
+    /* usually only accessible by root */
+    is_debug("storage", "could not open %s to read SMART log: %s",
+             entry, g_strerror(errno));
+    goto out;
+  }
+  add_sensor(self, entry, model, fd, NULL, 0);
+#else
+  is_debug("storage", "ignoring %s as it has no hwmon device", entry);
+#endif
+
+out:
+  g_free(hwmon);
+  g_free(model);
+  g_free(dir);
+}
+
+static void
+is_storage_plugin_activate(PeasActivatable *activatable)
+{
+  IsStoragePlugin *self = IS_STORAGE_PLUGIN(activatable);
+  IsStoragePluginPrivate *priv = self->priv;
+  const gchar *entry;
+  GDir *dir;
+
+  /* discover all drives once - each keeps its attribute open for the
+   * lifetime of its sensor so no request is made over D-Bus */
+  is_debug("storage", "searching for sensors");
+  dir = g_dir_open(HWMON_CLASS_DIR, 0, NULL);
+  if (dir)
+  {
+    while ((entry = g_dir_read_name(dir)) != NULL)
+    {
+      process_drivetemp(self, entry);
+    }
+    g_dir_close(dir);
+  }
+  dir = g_dir_open(NVME_CLASS_DIR, 0, NULL);
+  if (dir)
+  {
+    while ((entry = g_dir_read_name(dir)) != NULL)
+    {
+      process_nvme(self, entry);
+    }
+    g_dir_close(dir);
+  }
+  if (priv->pool)
+  {
+    g_signal_connect(priv->application,
+                     "update-values::" STORAGE_PATH_PREFIX,
+                     G_CALLBACK(update_values), self);
+  }
+}
+
+static void
+is_storage_plugin_deactivate(PeasActivatable *activatable)
+{
+  IsStoragePlugin *plugin = IS_STORAGE_PLUGIN(activatable);
+  IsStoragePluginPrivate *priv = plugin->priv;
+  IsManager *manager;
+  guint i;
+
+  g_signal_handlers_disconnect_by_func(priv->application, update_values,
+                                       plugin);
+  /* drop anything still waiting to be read - a read in flight is
+   * published (and its sensors released) when it completes */
+  for (i = 0; i < priv->pending->len; i++)
+  {
+    StorageBinding *binding = g_ptr_array_index(priv->pending, i);
+    binding->queued = FALSE;
+    g_object_unref(binding->sensor);
+  }
+  g_ptr_array_set_size(priv->pending, 0);
+  manager = is_application_get_manager(priv->application);
+  is_manager_remove_paths_with_prefix(manager, STORAGE_PATH_PREFIX);
+}
+
+static void
+is_storage_plugin_class_init(IsStoragePluginClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+  g_type_class_add_private(klass, sizeof(IsStoragePluginPrivate));
+
+  gobject_class->get_property = is_storage_plugin_get_property;
+  gobject_class->set_property = is_storage_plugin_set_property;
+  gobject_class->finalize = is_storage_plugin_finalize;
+
+  g_object_class_override_property(gobject_class, PROP_OBJECT, "object");
+}
+
+static void
+peas_activatable_iface_init(PeasActivatableInterface *iface)
+{
+  iface->activate = is_storage_plugin_activate;
+  iface->deactivate = is_storage_plugin_deactivate;
+}
+
+static void
+is_storage_plugin_class_finalize(IsStoragePluginClass *klass)
+{
+  /* nothing to do */
+}
+
+G_MODULE_EXPORT void
+peas_register_types(PeasObjectModule *module)
+{
+  is_storage_plugin_register_type(G_TYPE_MODULE(module));
+
+  peas_object_module_register_extension_type(module,
+      PEAS_TYPE_ACTIVATABLE,
+      IS_TYPE_STORAGE_PLUGIN);
+}
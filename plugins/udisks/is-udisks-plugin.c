@@ -23,6 +23,7 @@
 #include <indicator-sensors/is-log.h>
 #include <indicator-sensors/is-application.h>
 #include <indicator-sensors/is-temperature-sensor.h>
+#include <indicator-sensors/is-sysfs.h>
 #include <atasmart.h>
 #include <gio/gio.h>
 #include <glib/gi18n.h>
@@ -31,6 +32,7 @@
 #define UDISKS_INTERFACE_NAME        "org.freedesktop.UDisks"
 #define UDISKS_OBJECT_PATH           "/org/freedesktop/UDisks"
 #define UDISKS_DEVICE_INTERFACE_NAME "org.freedesktop.UDisks.Device"
+#define DBUS_PROPERTIES_INTERFACE    "org.freedesktop.DBus.Properties"
 
 #define UDISKS_PATH_PREFIX "udisks"
 
@@ -53,8 +55,19 @@ struct _IsUdisksPluginPrivate
   IsApplication *application;
   GHashTable *sensors;
   GDBusConnection *connection;
+  GCancellable *cancellable;
 };
 
+/* bound to each sensor as the user data for its update-value handler */
+typedef struct
+{
+  IsUdisksPlugin *plugin;
+  IsSensor *sensor;
+  GDBusProxy *proxy;
+  /* whether a refresh is in flight */
+  gboolean busy;
+} UdisksBinding;
+
 static void is_udisks_plugin_finalize(GObject *object);
 
 static void
@@ -104,6 +117,7 @@ is_udisks_plugin_init(IsUdisksPlugin *self)
     G_TYPE_INSTANCE_GET_PRIVATE(self, IS_TYPE_UDISKS_PLUGIN,
                                 IsUdisksPluginPrivate);
   self->priv = priv;
+  priv->cancellable = g_cancellable_new();
 }
 
 static void
@@ -112,6 +126,7 @@ is_udisks_plugin_finalize(GObject *object)
   IsUdisksPlugin *self = (IsUdisksPlugin *)object;
   IsUdisksPluginPrivate *priv = self->priv;
 
+  g_object_unref(priv->cancellable);
   if (priv->application)
   {
     g_object_unref(priv->application);
@@ -121,82 +136,60 @@ is_udisks_plugin_finalize(GObject *object)
 }
 
 static void
-update_sensor_value(IsTemperatureSensor *sensor,
-                    IsUdisksPlugin *self)
+udisks_binding_free(UdisksBinding *binding,
+                    GClosure *closure)
+{
+  g_object_unref(binding->proxy);
+  g_slice_free(UdisksBinding, binding);
+}
 
+/* called once a refresh has completed, successfully or not - drops the
+ * references taken when it was started */
+static void
+refresh_done(UdisksBinding *binding)
 {
-  IsUdisksPluginPrivate *priv;
-  gchar *device, *path;
-  GDBusProxy *proxy;
-  GVariant *var;
+  IsUdisksPlugin *self = binding->plugin;
+
+  binding->busy = FALSE;
+  g_object_unref(binding->sensor);
+  g_object_unref(self);
+}
+
+static void
+smart_blob_ready(GObject *source,
+                 GAsyncResult *res,
+                 UdisksBinding *binding)
+{
+  IsSensor *sensor = binding->sensor;
+  GVariant *result, *var = NULL;
   GError *error = NULL;
   SkDisk *sk_disk;
   const gchar *blob;
   gsize len;
   guint64 temperature;
   gdouble value;
-  const gchar * const options[] = { "nowakeup", NULL };
-
-  priv = self->priv;
-
-  device = g_path_get_basename(is_sensor_get_path(IS_SENSOR(sensor)));
-  path = g_strdup_printf("%s/devices/%s", UDISKS_OBJECT_PATH, device);
-  proxy = g_dbus_proxy_new_sync(priv->connection,
-                                G_DBUS_PROXY_FLAGS_DO_NOT_CONNECT_SIGNALS,
-                                NULL,
-                                UDISKS_BUS_NAME,
-                                path,
-                                UDISKS_DEVICE_INTERFACE_NAME,
-                                NULL, &error);
-  g_free(path);
-  g_free(device);
 
-  if (!proxy)
-  {
-    g_prefix_error(&error,
-                   _("Error reading new SMART data for sensor %s"),
-                   is_sensor_get_path(IS_SENSOR(sensor)));
-    is_sensor_set_error(IS_SENSOR(sensor), error->message);
-    g_error_free(error);
-    goto out;
-  }
-
-  /* update smart data */
-  var = g_variant_new_strv(options, 0);
-  var = g_dbus_proxy_call_sync(proxy, "DriveAtaSmartRefreshData",
-                               g_variant_new_tuple(&var, 1),
-                               G_DBUS_CALL_FLAGS_NONE,
-                               -1, NULL, &error);
-  if (!var)
+  result = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source), res,
+                                         &error);
+  if (!result)
   {
-    g_prefix_error(&error,
-                   _("Error refreshing SMART data for sensor %s"),
-                   is_sensor_get_path(IS_SENSOR(sensor)));
-    is_sensor_set_error(IS_SENSOR(sensor), error->message);
+    if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    {
+      is_debug("udisks", "unable to get atasmartblob for sensor %s: %s",
+               is_sensor_get_path(sensor), error->message);
+    }
     g_error_free(error);
-    g_object_unref(proxy);
-    goto out;
-  }
-  g_variant_unref(var);
-
-  var = g_dbus_proxy_get_cached_property(proxy,
-                                         "DriveAtaSmartBlob");
-  if (!var)
-  {
-    is_debug("udisks", "unable to get atasmartblob for sensor %s",
-             is_sensor_get_path(IS_SENSOR(sensor)));
-    g_object_unref(proxy);
     goto out;
   }
-  g_object_unref(proxy);
+  g_variant_get(result, "(v)", &var);
+  g_variant_unref(result);
 
   /* can't unref var until done with blob */
   blob = g_variant_get_fixed_array(var, &len, sizeof(gchar));
-  if (!blob)
+  if (!blob || !len)
   {
     /* this can occur if udisks doesn't update immediately,
      * ignore */
-    g_variant_unref(var);
     goto out;
   }
   sk_disk_open(NULL, &sk_disk);
@@ -204,166 +197,309 @@ update_sensor_value(IsTemperatureSensor *sensor,
   if (sk_disk_smart_get_temperature(sk_disk, &temperature) < 0)
   {
     is_debug("udisks", "Error getting temperature from AtaSmartBlob for sensor %s",
-             is_sensor_get_path(IS_SENSOR(sensor)));
+             is_sensor_get_path(sensor));
     sk_disk_free(sk_disk);
-    g_variant_unref(var);
     /* TODO: emit error */
     goto out;
   }
-
   sk_disk_free(sk_disk);
-  g_variant_unref(var);
 
   /* Temperature is in mK, so convert it to K first */
   temperature /= 1000;
   value = (gdouble)temperature - 273.15;
-  is_temperature_sensor_set_celsius_value(sensor, value);
-  is_sensor_set_error(IS_SENSOR(sensor), NULL);
+  is_temperature_sensor_set_celsius_value(IS_TEMPERATURE_SENSOR(sensor),
+                                          value);
+  is_sensor_set_error(sensor, NULL);
 
 out:
-  return;
+  if (var)
+  {
+    g_variant_unref(var);
+  }
+  refresh_done(binding);
 }
 
 static void
-is_udisks_plugin_activate(PeasActivatable *activatable)
+smart_refresh_ready(GObject *source,
+                    GAsyncResult *res,
+                    UdisksBinding *binding)
 {
-  IsUdisksPlugin *self = IS_UDISKS_PLUGIN(activatable);
-  IsUdisksPluginPrivate *priv = self->priv;
-  GDBusProxy *proxy;
+  IsUdisksPluginPrivate *priv = binding->plugin->priv;
+  IsSensor *sensor = binding->sensor;
+  GDBusProxy *proxy = G_DBUS_PROXY(source);
+  GVariant *var;
   GError *error = NULL;
-  GVariant *container, *paths;
-  GVariantIter iter;
-  gchar *path;
 
-  priv->connection = g_bus_get_sync(G_BUS_TYPE_SYSTEM, NULL, &error);
-  if (!priv->connection)
+  var = g_dbus_proxy_call_finish(proxy, res, &error);
+  if (!var)
   {
-    is_warning("udisks", "Failed to open connection to system dbus: %s",
-               error->message);
+    if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    {
+      g_prefix_error(&error,
+                     _("Error refreshing SMART data for sensor %s"),
+                     is_sensor_get_path(sensor));
+      is_sensor_set_error(sensor, error->message);
+    }
     g_error_free(error);
+    refresh_done(binding);
     goto out;
   }
+  g_variant_unref(var);
 
-  /* This is the proxy which is only used once during the enumeration of
-   * the device object paths
-   */
-  proxy = g_dbus_proxy_new_sync(priv->connection,
-                                G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES |
-                                G_DBUS_PROXY_FLAGS_DO_NOT_CONNECT_SIGNALS,
+  /* udisks only signals Changed rather than PropertiesChanged so the
+   * proxy's cached copy of the blob is stale - fetch it explicitly */
+  g_dbus_connection_call(g_dbus_proxy_get_connection(proxy),
+                         UDISKS_BUS_NAME,
+                         g_dbus_proxy_get_object_path(proxy),
+                         DBUS_PROPERTIES_INTERFACE,
+                         "Get",
+                         g_variant_new("(ss)",
+                                       UDISKS_DEVICE_INTERFACE_NAME,
+                                       "DriveAtaSmartBlob"),
+                         G_VARIANT_TYPE("(v)"),
+                         G_DBUS_CALL_FLAGS_NONE,
+                         -1, priv->cancellable,
+                         (GAsyncReadyCallback)smart_blob_ready, binding);
+
+out:
+  return;
+}
 
-                                NULL,
-                                UDISKS_BUS_NAME,
-                                UDISKS_OBJECT_PATH,
-                                UDISKS_INTERFACE_NAME,
-                                NULL, &error);
+static void
+update_sensor_value(IsSensor *sensor,
+                    UdisksBinding *binding)
+{
+  IsUdisksPluginPrivate *priv = binding->plugin->priv;
+  const gchar * const options[] = { "nowakeup", NULL };
+
+  /* a slow disk may still be busy with the last refresh */
+  if (binding->busy)
+  {
+    goto out;
+  }
+  binding->busy = TRUE;
+  /* keep us and sensor (and hence binding) alive until the refresh is
+   * done */
+  g_object_ref(binding->plugin);
+  g_object_ref(sensor);
+  /* update smart data */
+  g_dbus_proxy_call(binding->proxy, "DriveAtaSmartRefreshData",
+                    g_variant_new("(^as)", options),
+                    G_DBUS_CALL_FLAGS_NONE,
+                    -1, priv->cancellable,
+                    (GAsyncReadyCallback)smart_refresh_ready, binding);
+
+out:
+  return;
+}
+
+static void
+device_proxy_ready(GObject *source,
+                   GAsyncResult *res,
+                   IsUdisksPlugin *self)
+{
+  IsUdisksPluginPrivate *priv = self->priv;
+  GDBusProxy *proxy;
+  GVariant *model = NULL, *smart_available = NULL;
+  UdisksBinding *binding;
+  IsSensor *sensor;
+  GError *error = NULL;
+  const gchar *path;
+  gchar *name, *sensor_path;
 
+  proxy = g_dbus_proxy_new_finish(res, &error);
   if (!proxy)
   {
-    is_warning("udisks", "Error getting proxy to udisks on system bus: %s",
+    if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    {
+      is_debug("udisks", "error getting sensor proxy for disk: %s",
                error->message);
+    }
     g_error_free(error);
     goto out;
   }
+  path = g_dbus_proxy_get_object_path(proxy);
 
-  /* The object paths of the disks are enumerated and placed in an array
-   * of object paths
-   */
-  container = g_dbus_proxy_call_sync(proxy, "EnumerateDevices", NULL,
-                                     G_DBUS_CALL_FLAGS_NONE, -1, NULL,
-                                     &error);
+  smart_available = g_dbus_proxy_get_cached_property(proxy,
+                    "DriveAtaSmartIsAvailable");
+  if (!smart_available)
+  {
+    is_debug("udisks", "error getting smart status for disk %s",
+             path);
+    goto out;
+  }
+  if (!g_variant_get_boolean(smart_available))
+  {
+    is_debug("udisks", "drive %s does not support SMART monitoring, ignoring...",
+             path);
+    goto out;
+  }
+
+  model = g_dbus_proxy_get_cached_property(proxy, "DriveModel");
+  if (!model)
+  {
+    is_debug("udisks", "error getting drive model for disk %s",
+             path);
+    goto out;
+  }
+  /* object path is named after the block device */
+  name = g_path_get_basename(path);
+  if (is_sysfs_disk_has_drivetemp(name))
+  {
+    is_debug("udisks", "ignoring drive %s as it is read via drivetemp",
+             path);
+    g_free(name);
+    goto out;
+  }
+  sensor_path = g_strdup_printf(UDISKS_PATH_PREFIX "/%s", name);
+  sensor = is_temperature_sensor_new(sensor_path);
+  is_sensor_set_label(sensor, g_variant_get_string(model, NULL));
+  is_sensor_set_digits(sensor, 0);
+  is_sensor_set_icon(sensor, IS_STOCK_DISK);
+  /* only update every minute to avoid waking disk too much */
+  is_sensor_set_update_interval(sensor, 60);
+
+  /* the proxy is kept for refreshing so it is only created once */
+  binding = g_slice_new0(UdisksBinding);
+  binding->plugin = self;
+  binding->sensor = sensor;
+  binding->proxy = g_object_ref(proxy);
+  g_signal_connect_data(sensor, "update-value",
+                        G_CALLBACK(update_sensor_value),
+                        binding, (GClosureNotify)udisks_binding_free, 0);
+  is_manager_add_sensor(is_application_get_manager(priv->application),
+                        sensor);
+
+  g_free(sensor_path);
+  g_free(name);
+  g_object_unref(sensor);
+
+out:
+  if (model)
+  {
+    g_variant_unref(model);
+  }
+  if (smart_available)
+  {
+    g_variant_unref(smart_available);
+  }
+  if (proxy)
+  {
+    g_object_unref(proxy);
+  }
+  /* drop reference taken when requested */
+  g_object_unref(self);
+}
+
+static void
+enumerate_devices_ready(GObject *source,
+                        GAsyncResult *res,
+                        IsUdisksPlugin *self)
+{
+  IsUdisksPluginPrivate *priv = self->priv;
+  GVariant *container, *paths;
+  GVariantIter iter;
+  GError *error = NULL;
+  gchar *path;
+
+  container = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source), res,
+                                            &error);
   if (!container)
   {
-    is_warning("udisks", "Failed to enumerate disk devices: %s",
-               error->message);
+    if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    {
+      is_warning("udisks", "Failed to enumerate disk devices: %s",
+                 error->message);
+    }
     g_error_free(error);
-    g_object_unref(proxy);
     goto out;
   }
 
   paths = g_variant_get_child_value(container, 0);
   g_variant_unref(container);
 
+  /* sensors are added as each proxy becomes ready */
   g_variant_iter_init(&iter, paths);
   while (g_variant_iter_loop(&iter, "o", &path))
   {
-    /* This proxy is used to get the required data in order to build
-     * up the list of sensors
-     */
-    GDBusProxy *sensor_proxy;
-    GVariant *model, *smart_available;
-    IsSensor *sensor;
-    gchar *name, *sensor_path;
-
-    sensor_proxy = g_dbus_proxy_new_sync(priv->connection,
-                                         G_DBUS_PROXY_FLAGS_NONE,
-                                         NULL,
-                                         UDISKS_BUS_NAME,
-                                         path,
-                                         UDISKS_DEVICE_INTERFACE_NAME,
-                                         NULL,
-                                         &error);
+    g_dbus_proxy_new(priv->connection,
+                     G_DBUS_PROXY_FLAGS_DO_NOT_CONNECT_SIGNALS,
+                     NULL,
+                     UDISKS_BUS_NAME,
+                     path,
+                     UDISKS_DEVICE_INTERFACE_NAME,
+                     priv->cancellable,
+                     (GAsyncReadyCallback)device_proxy_ready,
+                     g_object_ref(self));
+  }
+  g_variant_unref(paths);
 
-    if (!sensor_proxy)
-    {
-      is_debug("udisks", "error getting sensor proxy for disk %s: %s",
-               path, error->message);
-      g_clear_error(&error);
-      g_object_unref(sensor_proxy);
-      continue;
-    }
+out:
+  g_object_unref(self);
+}
 
-    smart_available = g_dbus_proxy_get_cached_property(sensor_proxy,
-                      "DriveAtaSmartIsAvailable");
-    if (!smart_available)
-    {
-      is_debug("udisks", "error getting smart status for disk %s",
-               path);
-      g_object_unref(sensor_proxy);
-      continue;
-    }
-    if (!g_variant_get_boolean(smart_available))
-    {
-      is_debug("udisks", "drive %s does not support SMART monitoring, ignoring...",
-               path);
-      g_variant_unref(smart_available);
-      g_object_unref(sensor_proxy);
-      continue;
-    }
+static void
+bus_ready(GObject *source,
+          GAsyncResult *res,
+          IsUdisksPlugin *self)
+{
+  IsUdisksPluginPrivate *priv = self->priv;
+  GDBusConnection *connection;
+  GError *error = NULL;
 
-    g_variant_unref(smart_available);
-    model = g_dbus_proxy_get_cached_property(sensor_proxy,
-            "DriveModel");
-    if (!model)
+  connection = g_bus_get_finish(res, &error);
+  if (!connection)
+  {
+    if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
     {
-      is_debug("udisks", "error getting drive model for disk %s",
-               path);
-      g_clear_error(&error);
-      g_object_unref(sensor_proxy);
-      continue;
+      is_warning("udisks", "Failed to open connection to system dbus: %s",
+                 error->message);
     }
-    name = g_path_get_basename(path);
-    sensor_path = g_strdup_printf(UDISKS_PATH_PREFIX "/%s", name);
-    sensor = is_temperature_sensor_new(sensor_path);
-    is_sensor_set_label(sensor, g_variant_get_string(model, NULL));
-    is_sensor_set_digits(sensor, 0);
-    is_sensor_set_icon(sensor, IS_STOCK_DISK);
-    /* only update every minute to avoid waking disk too much */
-    is_sensor_set_update_interval(sensor, 60);
-    g_signal_connect(sensor, "update-value",
-                     G_CALLBACK(update_sensor_value), self);
-    is_manager_add_sensor(is_application_get_manager(priv->application),
-                          sensor);
-
-    g_free(sensor_path);
-    g_free(name);
-    g_object_unref(sensor);
-    g_object_unref(sensor_proxy);
+    g_error_free(error);
+    goto out;
   }
-  g_variant_unref(paths);
-  g_object_unref(proxy);
+  if (g_cancellable_is_cancelled(priv->cancellable))
+  {
+    g_object_unref(connection);
+    goto out;
+  }
+  priv->connection = connection;
+
+  /* The object paths of the disks are enumerated and placed in an array
+   * of object paths
+   */
+  g_dbus_connection_call(priv->connection,
+                         UDISKS_BUS_NAME,
+                         UDISKS_OBJECT_PATH,
+                         UDISKS_INTERFACE_NAME,
+                         "EnumerateDevices",
+                         NULL,
+                         G_VARIANT_TYPE("(ao)"),
+                         G_DBUS_CALL_FLAGS_NONE,
+                         -1, priv->cancellable,
+                         (GAsyncReadyCallback)enumerate_devices_ready,
+                         g_object_ref(self));
 
 out:
-  return;
+  g_object_unref(self);
+}
+
+static void
+is_udisks_plugin_activate(PeasActivatable *activatable)
+{
+  IsUdisksPlugin *self = IS_UDISKS_PLUGIN(activatable);
+  IsUdisksPluginPrivate *priv = self->priv;
+
+  /* may have been cancelled by a previous deactivation */
+  if (g_cancellable_is_cancelled(priv->cancellable))
+  {
+    g_object_unref(priv->cancellable);
+    priv->cancellable = g_cancellable_new();
+  }
+  /* nothing here may block as a slow or spun-down disk would otherwise
+   * hold up the whole indicator - each step holds a reference on us */
+  g_bus_get(G_BUS_TYPE_SYSTEM, priv->cancellable,
+            (GAsyncReadyCallback)bus_ready, g_object_ref(self));
 }
 
 static void
@@ -373,9 +509,12 @@ is_udisks_plugin_deactivate(PeasActivatable *activatable)
   IsUdisksPluginPrivate *priv = self->priv;
   IsManager *manager;
 
+  /* stop anything in flight */
+  g_cancellable_cancel(priv->cancellable);
   if (priv->connection)
   {
     g_object_unref(priv->connection);
+    priv->connection = NULL;
   }
   manager = is_application_get_manager(priv->application);
   is_manager_remove_paths_with_prefix(manager, UDISKS_PATH_PREFIX);
@@ -23,6 +23,7 @@
 #include <indicator-sensors/is-log.h>
 #include <indicator-sensors/is-application.h>
 #include <indicator-sensors/is-temperature-sensor.h>
+#include <indicator-sensors/is-sysfs.h>
 #include <udisks/udisks.h>
 #include <gio/gio.h>
 #include <glib/gi18n.h>
@@ -30,6 +31,9 @@
 
 #define UDISKS2_PATH_PREFIX "udisks2"
 
+/* maximum number of drives being sampled at once */
+#define MAX_SAMPLES_IN_FLIGHT 4
+
 static void peas_activatable_iface_init(PeasActivatableInterface *iface);
 
 G_DEFINE_DYNAMIC_TYPE_EXTENDED(IsUDisks2Plugin,
@@ -48,9 +52,39 @@ struct _IsUDisks2PluginPrivate
 {
   IsApplication *application;
   UDisksClient *client;
+  /* UDisks2Binding for each drive object path with a sensor */
   GHashTable *sensors;
+
+  /* drives are sampled in a refresh cycle started each tick - those due
+   * for the next cycle, those of the current cycle yet to be started and
+   * those whose results are waiting to be published */
+  GPtrArray *pending;
+  GQueue *queue;
+  GPtrArray *completed;
+  guint n_in_flight;
+  /* starts the next drive of the cycle so they are spread out */
+  guint pace_id;
+  guint publish_id;
 };
 
+/* bound to each sensor as the user data for its update-value handler so
+ * a sample needs no lookup of the drive */
+typedef struct
+{
+  IsUDisks2Plugin *plugin;
+  IsSensor *sensor;
+  UDisksDriveAta *drive;
+  /* cancelled when the drive is removed */
+  GCancellable *cancellable;
+  /* whether in pending, queue or completed - ie. holding a reference on
+   * sensor */
+  gboolean queued;
+  /* result of the last sample - value is only valid if has_value */
+  gdouble celsius;
+  gboolean has_value;
+  GError *error;
+} UDisks2Binding;
+
 static void is_udisks2_plugin_finalize(GObject *object);
 
 static void
@@ -100,6 +134,11 @@ is_udisks2_plugin_init(IsUDisks2Plugin *self)
     G_TYPE_INSTANCE_GET_PRIVATE(self, IS_TYPE_UDISKS2_PLUGIN,
                                 IsUDisks2PluginPrivate);
   self->priv = priv;
+  priv->sensors = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                        g_free, NULL);
+  priv->pending = g_ptr_array_new();
+  priv->queue = g_queue_new();
+  priv->completed = g_ptr_array_new();
 }
 
 static void
@@ -108,6 +147,12 @@ is_udisks2_plugin_finalize(GObject *object)
   IsUDisks2Plugin *self = (IsUDisks2Plugin *)object;
   IsUDisks2PluginPrivate *priv = self->priv;
 
+  /* samples in flight and unpublished results hold a reference on us */
+  g_assert(!priv->n_in_flight && !priv->publish_id);
+  g_ptr_array_free(priv->completed, TRUE);
+  g_queue_free(priv->queue);
+  g_ptr_array_free(priv->pending, TRUE);
+  g_hash_table_destroy(priv->sensors);
   if (priv->application)
   {
     g_object_unref(priv->application);
@@ -116,34 +161,118 @@ is_udisks2_plugin_finalize(GObject *object)
   G_OBJECT_CLASS(is_udisks2_plugin_parent_class)->finalize(object);
 }
 
+static void
+udisks2_binding_free(UDisks2Binding *binding,
+                     GClosure *closure)
+{
+  g_cancellable_cancel(binding->cancellable);
+  g_object_unref(binding->cancellable);
+  g_clear_object(&binding->drive);
+  g_clear_error(&binding->error);
+  g_slice_free(UDisks2Binding, binding);
+}
+
+/* drops the reference taken on sensor when it was queued */
+static void
+release_binding(UDisks2Binding *binding)
+{
+  binding->queued = FALSE;
+  g_object_unref(binding->sensor);
+}
+
+static gboolean
+publish_values(IsUDisks2Plugin *self)
+{
+  IsUDisks2PluginPrivate *priv = self->priv;
+  guint i;
+
+  for (i = 0; i < priv->completed->len; i++)
+  {
+    UDisks2Binding *binding = g_ptr_array_index(priv->completed, i);
+    IsSensor *sensor = binding->sensor;
+
+    is_sensor_freeze_changed(sensor);
+    if (binding->error)
+    {
+      is_sensor_set_error(sensor, binding->error->message);
+    }
+    else
+    {
+      if (binding->has_value)
+      {
+        is_temperature_sensor_set_celsius_value(IS_TEMPERATURE_SENSOR(sensor),
+                                                binding->celsius);
+      }
+      is_sensor_set_error(sensor, NULL);
+    }
+    is_sensor_thaw_changed(sensor);
+    g_clear_error(&binding->error);
+    release_binding(binding);
+  }
+  g_ptr_array_set_size(priv->completed, 0);
+  priv->publish_id = 0;
+  return FALSE;
+}
+
+/* called once a sample has completed, successfully or not - results which
+ * arrive together are published together */
+static void
+sample_done(UDisks2Binding *binding,
+            GError *error,
+            const gchar *format)
+{
+  IsUDisks2Plugin *self = binding->plugin;
+  IsUDisks2PluginPrivate *priv = self->priv;
+
+  priv->n_in_flight--;
+  if (error)
+  {
+    /* nobody cares if the sample was cancelled as the drive was removed */
+    if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    {
+      g_error_free(error);
+      release_binding(binding);
+      goto out;
+    }
+    g_prefix_error(&error, format, is_sensor_get_path(binding->sensor));
+    binding->error = error;
+  }
+  g_ptr_array_add(priv->completed, binding);
+  if (!priv->publish_id)
+  {
+    priv->publish_id = g_idle_add_full(G_PRIORITY_DEFAULT_IDLE,
+                                       (GSourceFunc)publish_values,
+                                       g_object_ref(self), g_object_unref);
+  }
+
+out:
+  /* drop reference taken when started */
+  g_object_unref(self);
+}
+
 static void
 smart_update_ready_cb(GObject *source,
                       GAsyncResult *res,
                       gpointer data)
 {
   UDisksDriveAta *drive = UDISKS_DRIVE_ATA(source);
-  IsTemperatureSensor *sensor = IS_TEMPERATURE_SENSOR(data);
+  UDisks2Binding *binding = data;
   GError *error = NULL;
-  gboolean ret;
   gdouble temp_k;
 
-  ret = udisks_drive_ata_call_smart_update_finish(drive, res, &error);
-  if (!ret)
+  if (!udisks_drive_ata_call_smart_update_finish(drive, res, &error))
   {
-    g_prefix_error(&error,
-                   _("Error reading new SMART data for sensor %s"),
-                   is_sensor_get_path(IS_SENSOR(sensor)));
-    is_sensor_set_error(IS_SENSOR(sensor), error->message);
-    g_error_free(error);
+    sample_done(binding, error,
+                _("Error reading new SMART data for sensor %s"));
     goto out;
   }
 
   /* temperature is in kelvin */
   temp_k = udisks_drive_ata_get_smart_temperature(drive);
   /* convert to celsius and set if is non-zero */
-  if (fabs(temp_k) > DBL_EPSILON)
-    is_temperature_sensor_set_celsius_value(sensor,  temp_k - 273.15);
-  is_sensor_set_error(IS_SENSOR(sensor), NULL);
+  binding->has_value = (fabs(temp_k) > DBL_EPSILON);
+  binding->celsius = temp_k - 273.15;
+  sample_done(binding, NULL, NULL);
 
 out:
   return;
@@ -155,7 +284,7 @@ pm_get_state_ready_cb(GObject *source,
                       gpointer data)
 {
   UDisksDriveAta *drive = UDISKS_DRIVE_ATA(source);
-  IsTemperatureSensor *sensor = IS_TEMPERATURE_SENSOR(data);
+  UDisks2Binding *binding = data;
   GError *error = NULL;
   gboolean ret;
   guchar state;
@@ -163,11 +292,8 @@ pm_get_state_ready_cb(GObject *source,
   ret = udisks_drive_ata_call_pm_get_state_finish(drive, &state, res, &error);
   if (!ret)
   {
-    g_prefix_error(&error,
-                   _("Error reading power management state for sensor %s"),
-                   is_sensor_get_path(IS_SENSOR(sensor)));
-    is_sensor_set_error(IS_SENSOR(sensor), error->message);
-    g_error_free(error);
+    sample_done(binding, error,
+                _("Error reading power management state for sensor %s"));
     goto out;
   }
 
@@ -178,7 +304,9 @@ pm_get_state_ready_cb(GObject *source,
   if (!state)
   {
     // standby - disk is idle so don't bother querying
-    is_temperature_sensor_set_celsius_value(sensor, 0);
+    binding->has_value = TRUE;
+    binding->celsius = 0;
+    sample_done(binding, NULL, NULL);
     goto out;
   }
 
@@ -188,47 +316,96 @@ pm_get_state_ready_cb(GObject *source,
                                         down */
                                      g_variant_new_parsed("{'nowakeup': %v}",
                                          g_variant_new_boolean(TRUE)),
-                                     NULL,
+                                     binding->cancellable,
                                      smart_update_ready_cb,
-                                     sensor);
-  is_sensor_set_error(IS_SENSOR(sensor), NULL);
+                                     binding);
 
 out:
   return;
 }
 
+/* starts sampling the next drive of the cycle if the window allows - only
+ * one is started each time so they are spread across the cycle */
+static gboolean
+start_next_sample(IsUDisks2Plugin *self)
+{
+  IsUDisks2PluginPrivate *priv = self->priv;
+
+  while (priv->n_in_flight < MAX_SAMPLES_IN_FLIGHT &&
+         !g_queue_is_empty(priv->queue))
+  {
+    UDisks2Binding *binding = g_queue_pop_head(priv->queue);
+
+    /* drive may have been removed since it was queued */
+    if (!binding->drive)
+    {
+      release_binding(binding);
+      continue;
+    }
+    binding->has_value = FALSE;
+    priv->n_in_flight++;
+    /* sample holds a reference on us until done */
+    g_object_ref(self);
+    udisks_drive_ata_call_pm_get_state(binding->drive,
+                                       g_variant_new("a{sv}", NULL),
+                                       binding->cancellable,
+                                       pm_get_state_ready_cb,
+                                       binding);
+    break;
+  }
+  if (g_queue_is_empty(priv->queue))
+  {
+    priv->pace_id = 0;
+    return FALSE;
+  }
+  return TRUE;
+}
+
 static void
-update_sensor_value(IsTemperatureSensor *sensor,
-                    IsUDisks2Plugin *self)
+update_sensor_value(IsSensor *sensor,
+                    UDisks2Binding *binding)
 {
-  GDBusObjectManager *manager;
-  gchar *path = NULL;
-  GDBusObject *object;
-  UDisksDriveAta *drive = NULL;
-
-  manager = udisks_client_get_object_manager(self->priv->client);
-  path = g_strdup_printf("/org/freedesktop/UDisks2/drives/%s",
-                         /* get id to find on bus as character past / */
-                         g_strrstr(is_sensor_get_path(IS_SENSOR(sensor)),
-                                   "/") + 1);
-  object = g_dbus_object_manager_get_object(manager, path);
-  if (!object)
+  /* drive has gone or is still waiting on the last sample - otherwise
+   * just queue as all due drives are sampled in a cycle started from
+   * update_values() */
+  if (binding->drive && !binding->queued)
   {
-    is_error("udisks2", "Error looking up drive with path %s", path);
-    goto out;
+    binding->queued = TRUE;
+    /* keep sensor alive until its value is published */
+    g_object_ref(sensor);
+    g_ptr_array_add(binding->plugin->priv->pending, binding);
   }
+}
 
-  g_object_get(object, "drive-ata", &drive, NULL);
-  udisks_drive_ata_call_pm_get_state(drive,
-                                     g_variant_new("a{sv}", NULL),
-                                     NULL,
-                                     pm_get_state_ready_cb,
-                                     sensor);
-out:
-  g_clear_object(&drive);
-  g_clear_object(&object);
-  g_free(path);
-  return;
+static void
+update_values(IsApplication *application,
+              GPtrArray *sensors,
+              IsUDisks2Plugin *self)
+{
+  IsUDisks2PluginPrivate *priv = self->priv;
+  guint i, interval = G_MAXUINT, n;
+
+  if (priv->pending->len == 0)
+  {
+    return;
+  }
+  for (i = 0; i < priv->pending->len; i++)
+  {
+    UDisks2Binding *binding = g_ptr_array_index(priv->pending, i);
+    interval = MIN(interval, is_sensor_get_update_interval(binding->sensor));
+    g_queue_push_tail(priv->queue, binding);
+  }
+  g_ptr_array_set_size(priv->pending, 0);
+
+  /* spread the drives of this cycle across the update interval so
+   * udisksd isn't hit with all of them at once - it then finishes in
+   * time for the next */
+  if (!priv->pace_id && start_next_sample(self))
+  {
+    n = g_queue_get_length(priv->queue);
+    priv->pace_id = g_timeout_add(MAX(interval * 1000 / (n + 1), 1),
+                                  (GSourceFunc)start_next_sample, self);
+  }
 }
 
 static void
@@ -238,6 +415,7 @@ object_removed_cb(GDBusObjectManager *obj_manager,
 {
   IsUDisks2Plugin *self;
   IsManager *manager;
+  UDisks2Binding *binding;
   const gchar *id;
   gchar *path = NULL;
 
@@ -250,6 +428,15 @@ object_removed_cb(GDBusObjectManager *obj_manager,
     goto out;
   }
 
+  /* stop any sample in flight and drop the drive */
+  binding = g_hash_table_lookup(self->priv->sensors, id);
+  if (binding)
+  {
+    g_cancellable_cancel(binding->cancellable);
+    g_clear_object(&binding->drive);
+    g_hash_table_remove(self->priv->sensors, id);
+  }
+
   id = g_strrstr(id, "/") + 1;
   path = g_strdup_printf(UDISKS2_PATH_PREFIX "/%s", id);
   manager = is_application_get_manager(self->priv->application);
@@ -260,6 +447,26 @@ out:
   g_free(path);
 }
 
+/* whether drive is read by the storage plugin via drivetemp instead */
+static gboolean
+drive_has_drivetemp(IsUDisks2Plugin *self,
+                    UDisksDrive *drive)
+{
+  UDisksBlock *block;
+  gchar *disk;
+  gboolean ret = FALSE;
+
+  block = udisks_client_get_block_for_drive(self->priv->client, drive, FALSE);
+  if (block)
+  {
+    disk = g_path_get_basename(udisks_block_get_device(block));
+    ret = is_sysfs_disk_has_drivetemp(disk);
+    g_free(disk);
+    g_object_unref(block);
+  }
+  return ret;
+}
+
 static void
 object_added_cb(GDBusObjectManager *manager,
                 GDBusObject *object,
@@ -268,15 +475,17 @@ object_added_cb(GDBusObjectManager *manager,
   IsUDisks2Plugin *self;
   UDisksDrive *drive = NULL;
   UDisksDriveAta *ata_drive = NULL;
-  const gchar *id;
+  UDisks2Binding *binding;
+  const gchar *object_path, *id;
   gchar *path = NULL;
   IsSensor *sensor;
 
   self = IS_UDISKS2_PLUGIN(data);
 
-  id = g_dbus_object_get_object_path(object);
+  object_path = g_dbus_object_get_object_path(object);
   /* ignore if is not a drive */
-  if (!g_str_has_prefix(id, "/org/freedesktop/UDisks2/drives/"))
+  if (!g_str_has_prefix(object_path, "/org/freedesktop/UDisks2/drives/") ||
+      g_hash_table_contains(self->priv->sensors, object_path))
   {
     goto out;
   }
@@ -287,11 +496,16 @@ object_added_cb(GDBusObjectManager *manager,
   if (!drive || !ata_drive ||
       !udisks_drive_ata_get_smart_enabled(ata_drive))
   {
-    is_debug("udisks2", "Ignoring drive at path %s as not ATA / SMART enabled\n", id);
+    is_debug("udisks2", "Ignoring drive at path %s as not ATA / SMART enabled\n", object_path);
+    goto out;
+  }
+  if (drive_has_drivetemp(self, drive))
+  {
+    is_debug("udisks2", "Ignoring drive at path %s as it is read via drivetemp", object_path);
     goto out;
   }
 
-  id = g_strrstr(id, "/") + 1;
+  id = g_strrstr(object_path, "/") + 1;
   path = g_strdup_printf("udisks2/%s", id);
   sensor = is_temperature_sensor_new(path);
   is_sensor_set_label(sensor, udisks_drive_get_model(drive));
@@ -299,11 +513,22 @@ object_added_cb(GDBusObjectManager *manager,
   is_sensor_set_icon(sensor, IS_STOCK_DISK);
   /* only update every minute to avoid waking disk too much */
   is_sensor_set_update_interval(sensor, 60);
-  g_signal_connect(sensor, "update-value",
-                   G_CALLBACK(update_sensor_value), self);
+
+  /* the drive is resolved once here and held until it is removed */
+  binding = g_slice_new0(UDisks2Binding);
+  binding->plugin = self;
+  binding->sensor = sensor;
+  binding->drive = ata_drive;
+  ata_drive = NULL;
+  binding->cancellable = g_cancellable_new();
+  g_signal_connect_data(sensor, "update-value",
+                        G_CALLBACK(update_sensor_value),
+                        binding, (GClosureNotify)udisks2_binding_free, 0);
+  g_hash_table_replace(self->priv->sensors, g_strdup(object_path), binding);
   is_debug("udisks2", "Adding sensor %s as drive added", id);
   is_manager_add_sensor(is_application_get_manager(self->priv->application),
                         sensor);
+  g_object_unref(sensor);
 
 out:
   g_free(path);
@@ -360,6 +585,9 @@ is_udisks2_plugin_activate(PeasActivatable *activatable)
 {
   IsUDisks2Plugin *self = IS_UDISKS2_PLUGIN(activatable);
 
+  g_signal_connect(self->priv->application,
+                   "update-values::" UDISKS2_PATH_PREFIX,
+                   G_CALLBACK(update_values), self);
   is_debug("udisks2", "Trying to get udisks client");
   udisks_client_new(NULL,
                     is_udisks2_plugin_client_ready_cb,
@@ -372,10 +600,42 @@ is_udisks2_plugin_deactivate(PeasActivatable *activatable)
   IsUDisks2Plugin *self = IS_UDISKS2_PLUGIN(activatable);
   IsUDisks2PluginPrivate *priv = self->priv;
   IsManager *manager;
-
+  GHashTableIter iter;
+  UDisks2Binding *binding;
+  guint i;
+
+  g_signal_handlers_disconnect_by_func(priv->application, update_values,
+                                       self);
+  /* drop anything yet to be started - results still to be published are
+   * released when they are */
+  if (priv->pace_id)
+  {
+    g_source_remove(priv->pace_id);
+    priv->pace_id = 0;
+  }
+  while (!g_queue_is_empty(priv->queue))
+  {
+    release_binding(g_queue_pop_head(priv->queue));
+  }
+  for (i = 0; i < priv->pending->len; i++)
+  {
+    release_binding(g_ptr_array_index(priv->pending, i));
+  }
+  g_ptr_array_set_size(priv->pending, 0);
+  /* stop any samples in flight - the sensors themselves go below */
+  g_hash_table_iter_init(&iter, priv->sensors);
+  while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&binding))
+  {
+    g_cancellable_cancel(binding->cancellable);
+    g_clear_object(&binding->drive);
+  }
+  g_hash_table_remove_all(priv->sensors);
   if (priv->client)
   {
+    g_signal_handlers_disconnect_by_data(udisks_client_get_object_manager(priv->client),
+                                         self);
     g_object_unref(priv->client);
+    priv->client = NULL;
   }
   manager = is_application_get_manager(priv->application);
   is_manager_remove_paths_with_prefix(manager, UDISKS2_PATH_PREFIX);